@@ -0,0 +1,81 @@
+#include "alloc_stats.h"
+
+#ifdef HERO_ALLOC_STATS
+#include <opencv2/opencv.hpp>
+#include <cstdlib>
+#include <new>
+
+using namespace cv;
+using namespace std;
+
+// 只用平凡类型，operator new中访问时不会触发线程局部变量的动态初始化
+static thread_local uint64_t tls_count = 0;
+static thread_local uint64_t tls_bytes = 0;
+
+AllocCounters alloc_thread_counters() {
+    AllocCounters c;
+    c.count = tls_count;
+    c.bytes = tls_bytes;
+    return c;
+}
+
+static void* counted_malloc(size_t n) {
+    void* p = malloc(n ? n : 1);
+    if (p) {
+        tls_count++;
+        tls_bytes += n;
+    }
+    return p;
+}
+
+static void* counted_new(size_t n) {
+    for (;;) {
+        void* p = counted_malloc(n);
+        if (p) return p;
+        new_handler h = get_new_handler();
+        if (!h) throw bad_alloc();
+        h();
+    }
+}
+
+// ============ 全局operator new/delete替换 ============
+void* operator new(size_t n) { return counted_new(n); }
+void* operator new[](size_t n) { return counted_new(n); }
+void* operator new(size_t n, const nothrow_t&) noexcept { return counted_malloc(n); }
+void* operator new[](size_t n, const nothrow_t&) noexcept { return counted_malloc(n); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, const nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const nothrow_t&) noexcept { free(p); }
+
+// ============ cv::Mat计数分配器 ============
+// 包装OpenCV默认分配器：数据区仍由fastMalloc分配，释放时UMatData指回原分配器
+class CountingMatAllocator : public MatAllocator {
+public:
+    UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                       AccessFlag flags, UMatUsageFlags usage) const override {
+        UMatData* u = Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage);
+        if (u && !data) {  // 包装外部缓冲区的Mat不分配数据区
+            tls_count++;
+            tls_bytes += u->size;
+        }
+        return u;
+    }
+    bool allocate(UMatData* u, AccessFlag flags, UMatUsageFlags usage) const override {
+        return Mat::getStdAllocator()->allocate(u, flags, usage);
+    }
+    void deallocate(UMatData* u) const override {
+        Mat::getStdAllocator()->deallocate(u);
+    }
+};
+
+namespace {
+struct InstallMatAllocator {
+    InstallMatAllocator() {
+        static CountingMatAllocator allocator;
+        Mat::setDefaultAllocator(&allocator);
+    }
+} install_mat_allocator;
+}  // namespace
+
+#endif // HERO_ALLOC_STATS
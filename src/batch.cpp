@@ -0,0 +1,358 @@
+#include "batch.h"
+#include "thread_pool.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+// ============ 单文件处理 ============
+// 出错时填写res.error并返回，res.ok保持false
+static void run_batch_range(const BatchJob& job, BatchResult& res) {
+    auto wall_start = steady_clock::now();
+
+    VideoCapture cap(job.input);
+    if (!cap.isOpened()) {
+        res.error = "cannot open video";
+        return;
+    }
+    if (job.start_frame > 0) {
+        cap.set(CAP_PROP_POS_FRAMES, (double)job.start_frame);
+        long pos = (long)cap.get(CAP_PROP_POS_FRAMES);
+        if (pos != job.start_frame) {
+            res.error = "seek to frame " + to_string(job.start_frame) + " landed on " + to_string(pos);
+            return;
+        }
+    }
+
+    ofstream pkt_out(job.output_stem + ".pkt", ios::binary);
+    ofstream csv_out(job.output_stem + ".csv");
+    if (!pkt_out || !csv_out) {
+        res.error = "cannot create output " + job.output_stem;
+        return;
+    }
+    csv_out << "frame,frame_seq,rle_bytes,truncated,balls,decode_us,process_us\n";
+
+    // 每个区间从全新的压缩器状态开始；帧号与frame_seq按读到的绝对帧号续接，空帧也占一个序号
+    HeroCamCompressor compressor;
+    FrameEnvelope frame;
+    uint8_t frame_seq = 0;
+
+    while (job.end_frame < 0 || job.start_frame + res.frames_read < job.end_frame) {
+        int64_t t0 = monotonic_us();
+        if (!cap.read(frame.image)) break;
+        int64_t t1 = monotonic_us();
+        long index = job.start_frame + res.frames_read++;
+        if (frame.image.empty()) continue;
+
+        frame.meta = FrameMeta();
+        frame.meta.capture_us = t1;
+        frame.meta.source_seq = (uint32_t)index;
+
+        ProcessResult result = compressor.process(frame);
+        frame_seq = (uint8_t)(index + 1);
+        result.packet.frame_seq = frame_seq;
+        packet_seal(result.packet);
+        pkt_out.write(reinterpret_cast<const char*>(&result.packet), sizeof(MqttPacket));
+
+        long decode_us = (long)(t1 - t0);
+        long process_us = (long)(result.meta.process_end_us - result.meta.process_start_us);
+        bool truncated = (result.packet.config & CFG_TRUNCATED) != 0;
+        csv_out << frame.meta.source_seq << ',' << (int)frame_seq << ',' << result.rle_used_byte << ','
+                << truncated << ',' << result.ballCount << ','
+                << decode_us << ',' << process_us << '\n';
+
+        res.frames++;
+        res.packet_bytes += sizeof(MqttPacket);
+        res.rle_bytes += result.rle_used_byte;
+        res.rle_max = max(res.rle_max, result.rle_used_byte);
+        if (truncated) res.truncated++;
+        if (result.ballCount > 0) res.ball_frames++;
+        res.decode_sec += decode_us / 1e6;
+        res.process_sec += process_us / 1e6;
+    }
+
+    res.ok = true;
+    res.wall_sec = duration_cast<duration<double>>(steady_clock::now() - wall_start).count();
+}
+
+// 解码或process()抛出的异常（如损坏帧触发的OpenCV断言）只让当前文件失败，不中断整个批次
+BatchResult run_batch_job(const BatchJob& job) {
+    BatchResult res;
+    res.input = job.input;
+    try {
+        run_batch_range(job, res);
+    } catch (const cv::Exception& e) {
+        res.ok = false;
+        res.error = "OpenCV error at frame " + to_string(job.start_frame + res.frames) + ": " + e.what();
+    } catch (const exception& e) {
+        res.ok = false;
+        res.error = "error at frame " + to_string(job.start_frame + res.frames) + ": " + e.what();
+    }
+    return res;
+}
+
+// ============ 帧区间切分与拼接 ============
+vector<BatchJob> split_job(const BatchJob& job, long total_frames, int parts, int gop) {
+    vector<BatchJob> ranges;
+    if (gop < 1) gop = 1;
+    long max_parts = total_frames / MIN_RANGE_FRAMES;
+    if (parts > max_parts) parts = (int)max_parts;
+    if (parts <= 1 || total_frames <= 0) {
+        ranges.push_back(job);
+        return ranges;
+    }
+
+    long start = 0;
+    for (int k = 0; k < parts; k++) {
+        long end = total_frames * (k + 1) / parts;
+        end = (end + gop / 2) / gop * gop;  // 对齐到最近的关键帧
+        // 最后一段读到文件结尾，不依赖帧数估计；向上对齐越过结尾的边界也并入最后一段
+        if (k == parts - 1 || end >= total_frames) end = -1;
+        if (end >= 0 && end <= start) continue;
+
+        BatchJob r = job;
+        r.start_frame = start;
+        r.end_frame = end;
+        r.output_stem = job.output_stem + ".part" + to_string(ranges.size());
+        ranges.push_back(r);
+        if (end < 0) break;
+        start = end;
+    }
+    return ranges;
+}
+
+static bool append_file(ofstream& out, const string& path, bool skip_first_line) {
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+    if (skip_first_line) {
+        string header;
+        getline(in, header);
+    }
+    out << in.rdbuf();
+    in.close();
+    remove(path.c_str());
+    return true;
+}
+
+BatchResult merge_ranges(const string& output_stem, const vector<BatchJob>& ranges,
+                         const vector<BatchResult>& parts) {
+    BatchResult res;
+    res.input = ranges.front().input;
+    res.ok = true;
+    for (const auto& p : parts) {
+        if (!p.ok) {
+            res.ok = false;
+            res.error = p.error;
+        }
+        res.frames += p.frames;
+        res.frames_read += p.frames_read;
+        res.packet_bytes += p.packet_bytes;
+        res.rle_bytes += p.rle_bytes;
+        res.rle_max = max(res.rle_max, p.rle_max);
+        res.truncated += p.truncated;
+        res.ball_frames += p.ball_frames;
+        res.decode_sec += p.decode_sec;
+        res.process_sec += p.process_sec;
+        res.wall_sec = max(res.wall_sec, p.wall_sec);  // 各区间并行，取最慢一段
+    }
+    if (ranges.size() == 1) return res;
+
+    // 区间帧数与切分不符说明帧数估计或seek不准，拼接结果会有缺帧/重帧
+    for (size_t k = 0; k + 1 < ranges.size() && res.ok; k++) {
+        if (parts[k].frames_read != ranges[k].end_frame - ranges[k].start_frame) {
+            res.ok = false;
+            res.error = "range " + to_string(k) + " decoded " + to_string(parts[k].frames_read) +
+                        " frames, expected " + to_string(ranges[k].end_frame - ranges[k].start_frame);
+        }
+    }
+
+    ofstream pkt_out(output_stem + ".pkt", ios::binary);
+    ofstream csv_out(output_stem + ".csv");
+    for (size_t k = 0; k < ranges.size(); k++) {
+        bool ok = append_file(pkt_out, ranges[k].output_stem + ".pkt", false) &&
+                  append_file(csv_out, ranges[k].output_stem + ".csv", k > 0);
+        if (!ok && res.ok) {
+            res.ok = false;
+            res.error = "missing output of range " + to_string(k);
+        }
+    }
+    return res;
+}
+
+// ============ 汇总表 ============
+static string base_name(const string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+void print_batch_summary(const vector<BatchResult>& results, double wall_sec) {
+    cout << "\n===== BATCH SUMMARY =====" << endl;
+    cout << left << setw(28) << "File" << right
+         << setw(8) << "Frames" << setw(11) << "PktBytes" << setw(9) << "RLEavg"
+         << setw(8) << "RLEmax" << setw(7) << "Trunc" << setw(8) << "Balls"
+         << setw(10) << "Decode s" << setw(10) << "Proc s" << setw(9) << "Wall s"
+         << setw(9) << "FPS" << endl;
+
+    long total_frames = 0, total_bytes = 0;
+    double total_proc = 0;
+    int failed = 0;
+    for (const auto& r : results) {
+        string name = base_name(r.input);
+        if (name.size() > 27) name = name.substr(0, 24) + "...";
+        cout << left << setw(28) << name << right;
+        if (!r.ok) {
+            cout << "  FAILED: " << r.error << endl;
+            failed++;
+            continue;
+        }
+        cout << setw(8) << r.frames << setw(11) << r.packet_bytes
+             << setw(9) << fixed << setprecision(1)
+             << (r.frames ? (double)r.rle_bytes / r.frames : 0.0)
+             << setw(8) << r.rle_max << setw(7) << r.truncated << setw(8) << r.ball_frames
+             << setw(10) << setprecision(2) << r.decode_sec
+             << setw(10) << r.process_sec << setw(9) << r.wall_sec
+             << setw(9) << setprecision(1) << (r.wall_sec > 0 ? r.frames / r.wall_sec : 0.0)
+             << endl;
+        total_frames += r.frames;
+        total_bytes += r.packet_bytes;
+        total_proc += r.process_sec;
+    }
+    cout << "Files: " << results.size() << " (failed " << failed << ")"
+         << ", frames: " << total_frames << ", packet bytes: " << total_bytes << endl;
+    cout << "Wall: " << setprecision(2) << wall_sec << " s, aggregate "
+         << setprecision(1) << (wall_sec > 0 ? total_frames / wall_sec : 0.0) << " fps"
+         << ", parallel speedup " << setprecision(2)
+         << (wall_sec > 0 ? total_proc / wall_sec : 0.0) << "x" << endl;
+    cout << "=========================" << endl;
+}
+
+// ============ 主函数 ============
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog << " [-j THREADS] [-o OUT_DIR] [--list FILE]"
+            " [--split K|auto --gop N] VIDEO...\n"
+            "  --split requires --gop: the encoder's keyframe interval in frames; range boundaries\n"
+            "  are rounded to multiples of it so every seek lands on a keyframe" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    int threads = 0;
+    string out_dir = "batch_out";
+    int split = 1;  // 每个文件切分的区间数，0表示自动
+    int gop = 0;    // 关键帧间隔，区间边界按其对齐；切分时必须指定
+    vector<string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--split" && i + 1 < argc) {
+            string v = argv[++i];
+            split = (v == "auto") ? 0 : max(1, atoi(v.c_str()));
+        } else if (arg == "--gop" && i + 1 < argc) {
+            gop = max(1, atoi(argv[++i]));
+        } else if (arg == "-o" && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (arg == "--list" && i + 1 < argc) {
+            ifstream list(argv[++i]);
+            string line;
+            while (getline(list, line)) {
+                if (!line.empty() && line[0] != '#') inputs.push_back(line);
+            }
+        } else if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        } else if (!arg.empty() && arg[0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+    // OpenCV不提供关键帧位置，只能由用户给出GOP；不对齐时seek会落在非关键帧上
+    if (split != 1 && gop <= 0) {
+        cerr << "[错误] --split 需要同时指定 --gop（视频的关键帧间隔）" << endl;
+        usage(argv[0]);
+        return 1;
+    }
+    if (!createDir(out_dir)) {
+        cerr << "[错误] 无法创建目录: " << out_dir << endl;
+        return 1;
+    }
+
+    // 按文件并行，每个工作线程处理一个文件；关闭OpenCV内部并行避免线程超额
+    setNumThreads(1);
+    if (threads <= 0) threads = (int)thread::hardware_concurrency();
+    ThreadPool pool(threads);
+
+    vector<BatchJob> jobs;
+    set<string> used_stems;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        string stem = base_name(inputs[i]);
+        size_t dot = stem.find_last_of('.');
+        if (dot != string::npos) stem = stem.substr(0, dot);
+        if (used_stems.count(stem)) stem += "_" + to_string(i);
+        used_stems.insert(stem);
+
+        BatchJob job;
+        job.input = inputs[i];
+        job.output_stem = out_dir + "/" + stem;
+        jobs.push_back(job);
+    }
+
+    // 自动切分：文件数少于线程数时把长文件切开，使任务数约等于线程数
+    int parts = split;
+    if (parts == 0) parts = max(1, (int)((pool.size() + jobs.size() - 1) / jobs.size()));
+
+    vector<vector<BatchJob>> ranges;
+    size_t total_tasks = 0;
+    for (const auto& job : jobs) {
+        long total_frames = 0;
+        if (parts > 1) {
+            VideoCapture probe(job.input);
+            if (probe.isOpened()) total_frames = (long)probe.get(CAP_PROP_FRAME_COUNT);
+        }
+        ranges.push_back(split_job(job, total_frames, parts, gop));
+        total_tasks += ranges.back().size();
+    }
+
+    cout << "Processing " << jobs.size() << " files (" << total_tasks << " ranges) on "
+         << pool.size() << " threads..." << endl;
+    auto start = steady_clock::now();
+
+    vector<vector<future<BatchResult>>> futures(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        for (const auto& r : ranges[i]) {
+            futures[i].push_back(pool.submit([r]() { return run_batch_job(r); }));
+        }
+    }
+    vector<BatchResult> results;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        vector<BatchResult> parts_done;
+        for (auto& f : futures[i]) parts_done.push_back(f.get());
+        results.push_back(merge_ranges(jobs[i].output_stem, ranges[i], parts_done));
+        const BatchResult& r = results.back();
+        cout << "[" << (i + 1) << "/" << jobs.size() << "] " << r.input
+             << (r.ok ? " done" : " FAILED: " + r.error) << endl;
+    }
+
+    double wall = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    print_batch_summary(results, wall);
+    print_pool_stats(pool);
+    // 有文件失败时返回非零，便于脚本判断
+    for (const auto& r : results) {
+        if (!r.ok) return 1;
+    }
+    return 0;
+}
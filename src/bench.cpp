@@ -0,0 +1,308 @@
+#include "header.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+using namespace cv;
+using namespace std;
+
+// ============ 无界面基准测试 ============
+// 不显示、不节拍、不发送，逐帧读视频并压缩，输出JSON（吞吐、各阶段分位数、RLE字节分布、截断率），
+// 便于脚本化运行并在版本之间对比。默认跑 vid/ 下的三段测试视频。
+
+static const char* const DEFAULT_CLIPS[] = {"test_video1.mp4", "test_video2.mp4", "test_video3.avi"};
+constexpr int RLE_HIST_BIN = 16;  // RLE字节分布的分箱宽度
+
+struct BenchConfig {
+    vector<string> sources;
+    string mode = "process";   // process：完整process()（含可视化结果与阶段计时）；encode：只生成数据包
+    int threads = 0;           // 大于0时弹丸分支交给线程池并行
+    string codec = "rle";      // rle / sync
+    int resync_rows = DEFAULT_RESYNC_ROWS;  // codec=sync时的同步标记间隔
+    long frame_limit = -1;     // 每个源计入统计的帧数上限，-1表示读到结尾
+    int warmup = 10;           // 不计入统计的预热帧数
+    string json_path;          // 为空时输出到stdout
+};
+
+struct SourceBench {
+    string source;
+    bool ok = false;
+    string error;
+    int width = 0;
+    int height = 0;
+    long frames = 0;
+    double wall_sec = 0;       // 统计帧的墙钟时间（含视频解码）
+    LatencyHistogram stages[STAGE_COUNT];
+    uint64_t allocs[STAGE_COUNT] = {};
+    uint64_t alloc_bytes[STAGE_COUNT] = {};
+    vector<long> rle_counts = vector<long>(RLE_DATA_MAX_BYTE + 1, 0);  // 按RLE字节数计帧
+    long rle_total = 0;
+    long truncated = 0;
+    long ball_frames = 0;
+};
+
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog << " [--source FILE|CAM_INDEX]... [--mode process|encode] [--threads N]"
+            " [--codec rle|sync] [--resync-rows N] [--frames N] [--warmup N] [--json OUT.json]\n"
+            "  without --source, runs vid/test_video1.mp4, test_video2.mp4 and test_video3.avi" << endl;
+}
+
+static bool is_number(const string& s) {
+    return !s.empty() && all_of(s.begin(), s.end(), [](char c) { return isdigit((unsigned char)c) != 0; });
+}
+
+// 在当前目录与上级目录下找vid/（可执行文件通常在build/中运行）
+static vector<string> default_sources() {
+    vector<string> out;
+    for (const char* dir : {"vid/", "../vid/", "../../vid/"}) {
+        if (!ifstream(string(dir) + DEFAULT_CLIPS[0])) continue;
+        for (const char* clip : DEFAULT_CLIPS) out.push_back(string(dir) + clip);
+        break;
+    }
+    return out;
+}
+
+// ============ 单个源 ============
+static SourceBench run_source(const string& source, const BenchConfig& cfg, ThreadPool* pool) {
+    SourceBench b;
+    b.source = source;
+    VideoCapture cap;
+    if (is_number(source)) cap.open(atoi(source.c_str()));
+    else cap.open(source);
+    if (!cap.isOpened()) {
+        b.error = "cannot open source";
+        return b;
+    }
+
+    HeroCamCompressor compressor;
+    compressor.setThreadPool(pool);
+    compressor.setResyncRows(cfg.codec == "sync" ? cfg.resync_rows : 0);
+    bool full = cfg.mode == "process";
+
+    FrameEnvelope frame;
+    MqttPacket pkt;
+    long seen = 0;
+    int64_t start_us = monotonic_us();
+    while (cfg.frame_limit < 0 || b.frames < cfg.frame_limit) {
+        int64_t t0 = monotonic_us();
+        if (!cap.read(frame.image)) break;
+        int64_t t1 = monotonic_us();
+        if (frame.image.empty()) continue;
+        if (seen++ == cfg.warmup) start_us = t0;  // 预热结束，开始计墙钟
+
+        StageTimes st;
+        int rle_len, balls;
+        bool truncated;
+        if (full) {
+            frame.meta = FrameMeta();
+            frame.meta.capture_us = t0;
+            ProcessResult r = compressor.process(frame);
+            st = r.stages;
+            st.us[STAGE_PROCESS] = (int32_t)(r.meta.process_end_us - r.meta.process_start_us);
+            rle_len = r.rle_used_byte;
+            balls = r.ballCount;
+            truncated = (r.packet.config & CFG_TRUNCATED) != 0;
+        } else {
+            AllocCounters a0 = alloc_thread_counters();
+            int64_t p0 = monotonic_us();
+            rle_len = compressor.encode(frame.image, pkt, &balls);
+            st.us[STAGE_PROCESS] = (int32_t)(monotonic_us() - p0);
+            AllocCounters a1 = alloc_thread_counters();
+            st.allocs[STAGE_PROCESS] = (uint32_t)(a1.count - a0.count);
+            st.alloc_bytes[STAGE_PROCESS] = (uint32_t)(a1.bytes - a0.bytes);
+            truncated = (pkt.config & CFG_TRUNCATED) != 0;
+        }
+        st.us[STAGE_CAPTURE] = (int32_t)(t1 - t0);
+        if (seen <= cfg.warmup) continue;
+
+        if (full) {
+            for (int k = STAGE_GRAY; k <= STAGE_ENCODE; k++) {
+                st.allocs[STAGE_PROCESS] += st.allocs[k];
+                st.alloc_bytes[STAGE_PROCESS] += st.alloc_bytes[k];
+            }
+        }
+        for (int k = 0; k < STAGE_COUNT; k++) {
+            if (st.us[k] >= 0) b.stages[k].record(st.us[k]);
+            b.allocs[k] += st.allocs[k];
+            b.alloc_bytes[k] += st.alloc_bytes[k];
+        }
+        b.rle_counts[min(max(rle_len, 0), RLE_DATA_MAX_BYTE)]++;
+        b.rle_total += rle_len;
+        if (truncated) b.truncated++;
+        if (balls > 0) b.ball_frames++;
+        b.frames++;
+        b.width = frame.image.cols;
+        b.height = frame.image.rows;
+    }
+    b.wall_sec = (monotonic_us() - start_us) / 1e6;
+    if (b.frames == 0) {
+        b.error = seen > 0 ? "fewer frames than --warmup" : "no frames decoded";
+        return b;
+    }
+    b.ok = true;
+    return b;
+}
+
+// ============ JSON输出 ============
+static string json_str(const string& s) {
+    ostringstream o;
+    o << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') o << '\\' << c;
+        else if ((unsigned char)c < 0x20) o << "\\u" << hex << setw(4) << setfill('0') << (int)c << dec;
+        else o << c;
+    }
+    o << '"';
+    return o.str();
+}
+
+// RLE字节数的第p百分位（精确值，按帧计）
+static int rle_percentile(const SourceBench& b, double p) {
+    long rank = max(1L, min(b.frames, (long)(p / 100.0 * b.frames + 0.5)));
+    long seen = 0;
+    for (int i = 0; i <= RLE_DATA_MAX_BYTE; i++) {
+        seen += b.rle_counts[i];
+        if (seen >= rank) return i;
+    }
+    return RLE_DATA_MAX_BYTE;
+}
+
+static void write_source(ostream& out, const SourceBench& b) {
+    out << "    {\n      \"source\": " << json_str(b.source) << ",\n      \"ok\": " << (b.ok ? "true" : "false");
+    if (!b.ok) {
+        out << ",\n      \"error\": " << json_str(b.error) << "\n    }";
+        return;
+    }
+    const LatencyHistogram& proc = b.stages[STAGE_PROCESS];
+    out << ",\n      \"width\": " << b.width << ", \"height\": " << b.height
+        << ",\n      \"frames\": " << b.frames << ", \"wall_sec\": " << b.wall_sec
+        << ",\n      \"fps\": " << (b.wall_sec > 0 ? b.frames / b.wall_sec : 0.0)
+        << ", \"process_fps\": " << (proc.mean() > 0 ? 1e6 / proc.mean() : 0.0)
+        << ",\n      \"stages_us\": {";
+    bool first = true;
+    for (int k = 0; k < STAGE_COUNT; k++) {
+        const LatencyHistogram& h = b.stages[k];
+        if (h.count() == 0) continue;
+        out << (first ? "\n" : ",\n") << "        " << json_str(stage_name(k)) << ": {\"count\": " << h.count()
+            << ", \"mean\": " << h.mean() << ", \"p50\": " << h.percentile(50)
+            << ", \"p90\": " << h.percentile(90) << ", \"p99\": " << h.percentile(99)
+            << ", \"max\": " << h.max();
+        if (ALLOC_STATS_ENABLED) {
+            out << ", \"allocs_per_frame\": " << (double)b.allocs[k] / h.count()
+                << ", \"alloc_bytes_per_frame\": " << (double)b.alloc_bytes[k] / h.count();
+        }
+        out << "}";
+        first = false;
+    }
+    out << "\n      },\n      \"rle_bytes\": {\"limit\": " << RLE_DATA_MAX_BYTE
+        << ", \"mean\": " << (double)b.rle_total / b.frames
+        << ", \"p50\": " << rle_percentile(b, 50) << ", \"p90\": " << rle_percentile(b, 90)
+        << ", \"p99\": " << rle_percentile(b, 99) << ", \"max\": " << rle_percentile(b, 100)
+        << ",\n        \"bin_bytes\": " << RLE_HIST_BIN << ", \"histogram\": [";
+    for (int lo = 0; lo <= RLE_DATA_MAX_BYTE; lo += RLE_HIST_BIN) {
+        long n = 0;
+        for (int i = lo; i < lo + RLE_HIST_BIN && i <= RLE_DATA_MAX_BYTE; i++) n += b.rle_counts[i];
+        out << (lo ? ", " : "") << n;
+    }
+    out << "]},\n      \"truncated\": " << b.truncated
+        << ", \"truncation_rate\": " << (double)b.truncated / b.frames
+        << ", \"ball_frames\": " << b.ball_frames << "\n    }";
+}
+
+static void write_json(ostream& out, const BenchConfig& cfg, const vector<SourceBench>& results) {
+    long frames = 0;
+    double wall = 0;
+    for (const SourceBench& b : results) {
+        frames += b.frames;
+        wall += b.wall_sec;
+    }
+    char date[32];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+    out << fixed << setprecision(3);
+    out << "{\n  \"tool\": \"hero_bench\",\n  \"format\": 1,\n  \"date\": " << json_str(date)
+        << ",\n  \"build\": {\"opencv\": " << json_str(CV_VERSION)
+        << ", \"compiler\": " << json_str(__VERSION__)
+        << ", \"alloc_stats\": " << (ALLOC_STATS_ENABLED ? "true" : "false") << "}"
+        << ",\n  \"config\": {\"mode\": " << json_str(cfg.mode) << ", \"threads\": " << cfg.threads
+        << ", \"codec\": " << json_str(cfg.codec) << ", \"resync_rows\": " << (cfg.codec == "sync" ? cfg.resync_rows : 0)
+        << ", \"frame_limit\": " << cfg.frame_limit << ", \"warmup\": " << cfg.warmup
+        << ", \"packet_bytes\": " << sizeof(MqttPacket) << "},\n  \"sources\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        write_source(out, results[i]);
+        out << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ],\n  \"total\": {\"frames\": " << frames << ", \"wall_sec\": " << wall
+        << ", \"fps\": " << (wall > 0 ? frames / wall : 0.0) << "}\n}\n";
+}
+
+// ============ 主函数 ============
+int main(int argc, char* argv[]) {
+    BenchConfig cfg;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--source" && i + 1 < argc) cfg.sources.push_back(argv[++i]);
+        else if (arg == "--mode" && i + 1 < argc) cfg.mode = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc) cfg.threads = max(0, atoi(argv[++i]));
+        else if (arg == "--codec" && i + 1 < argc) cfg.codec = argv[++i];
+        else if (arg == "--resync-rows" && i + 1 < argc) cfg.resync_rows = max(1, atoi(argv[++i]));
+        else if (arg == "--frames" && i + 1 < argc) cfg.frame_limit = atol(argv[++i]);
+        else if (arg == "--warmup" && i + 1 < argc) cfg.warmup = max(0, atoi(argv[++i]));
+        else if (arg == "--json" && i + 1 < argc) cfg.json_path = argv[++i];
+        else if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if ((cfg.mode != "process" && cfg.mode != "encode") || (cfg.codec != "rle" && cfg.codec != "sync")) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (cfg.sources.empty()) cfg.sources = default_sources();
+    if (cfg.sources.empty()) {
+        cerr << "[错误] 未找到vid/目录下的测试视频，请用--source指定" << endl;
+        return 1;
+    }
+
+    unique_ptr<ThreadPool> pool;
+    if (cfg.threads > 0) pool.reset(new ThreadPool(cfg.threads));
+
+    // 进度信息走stderr，stdout只留JSON
+    vector<SourceBench> results;
+    bool all_ok = true;
+    for (const string& src : cfg.sources) {
+        cerr << "[bench] " << src << " ..." << flush;
+        results.push_back(run_source(src, cfg, pool.get()));
+        const SourceBench& b = results.back();
+        if (b.ok) {
+            cerr << " " << b.frames << " frames, " << fixed << setprecision(1)
+                 << (b.wall_sec > 0 ? b.frames / b.wall_sec : 0.0) << " fps" << endl;
+        } else {
+            cerr << " FAILED: " << b.error << endl;
+            all_ok = false;
+        }
+    }
+
+    if (cfg.json_path.empty()) {
+        write_json(cout, cfg, results);
+    } else {
+        ofstream out(cfg.json_path);
+        if (!out) {
+            cerr << "[错误] 无法写入: " << cfg.json_path << endl;
+            return 1;
+        }
+        write_json(out, cfg, results);
+        cerr << "Results written to " << cfg.json_path << endl;
+    }
+    return all_ok ? 0 : 1;
+}
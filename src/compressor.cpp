@@ -0,0 +1,374 @@
+#include "header.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+// ============ HeroCamCompressor 成员函数实现 ============
+HeroCamCompressor::HeroCamCompressor()
+    : kernel1_(getStructuringElement(MORPH_RECT, Size(2,2))),
+      kernel2_(getStructuringElement(MORPH_RECT, Size(4,4))) {}
+
+ProcessResult HeroCamCompressor::process(Mat& input) {
+    ProcessResult result;
+    if (input.empty()) return result;
+    result.rle_used_byte = encodeFrame(input, result.packet, &result);
+    return result;
+}
+
+int HeroCamCompressor::encode(const Mat& input, MqttPacket& pkt, int* ball_count) {
+    if (input.empty()) return -1;
+    int rle_len = encodeFrame(input, pkt, nullptr);
+    if (ball_count) {
+        *ball_count = 0;
+        for (int i = 0; i < 4; i++) {
+            if (pkt.balls[i].x != 0 || pkt.balls[i].y != 0) (*ball_count)++;
+        }
+    }
+    return rle_len;
+}
+
+// 中间图像都放在成员变量里复用，尺寸不变时OpenCV不会重新分配；
+// 只有 detail 非空（需要可视化结果）时才分配返回给调用者的图像
+int HeroCamCompressor::encodeFrame(const Mat& input, MqttPacket& pkt, ProcessResult* detail) {
+    int origW = input.cols;
+    int origH = input.rows;
+    // 只在需要结果细节时计时；encode()路径不开追踪时不读时钟
+    StageTimes* t = detail ? &detail->stages : nullptr;
+
+    // 2. HSV绿色弹丸提取（与轮廓分支互不依赖，有线程池时并行执行）
+    auto ball_branch = [&]() {
+        ScopedTimer timer(t, STAGE_HSV);
+        cvtColor(input, hsv_, COLOR_BGR2HSV);
+        inRange(hsv_, BALL_HSV_LOW, BALL_HSV_HIGH, greenMask_);
+        morphologyEx(greenMask_, greenMask_, MORPH_CLOSE, kernel1_);
+        dilate(greenMask_, greenMask_, kernel2_);
+
+        // OpenCV 3.2起findContours不再修改输入图像，无需clone
+        findContours(greenMask_, ballContours_, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+
+        // 按面积从大到小排序
+        sort(ballContours_.begin(), ballContours_.end(),
+             [](const vector<Point>& a, const vector<Point>& b) {
+                 return contourArea(a) > contourArea(b);
+             });
+    };
+    // 分支任务与本线程竞争认领：尚未被工作线程取走时由本线程内联执行。
+    // 不用pool_->wait()，它会在等待期间执行队列里其他流的process()或PNG写入，把别人的耗时算进本帧延迟
+    future<void> ball_done;
+    shared_ptr<atomic<bool>> ball_claimed;
+    if (pool_) {
+        ball_claimed = make_shared<atomic<bool>>(false);
+        shared_ptr<atomic<bool>> claimed = ball_claimed;
+        ball_done = pool_->submit([claimed, &ball_branch]() {
+            if (!claimed->exchange(true)) ball_branch();
+        });
+    }
+    // 等待弹丸分支结束；返回true表示分支由工作线程执行，异常需从future取出
+    auto join_ball_branch = [&]() {
+        if (!ball_claimed->exchange(true)) {
+            ball_branch();
+            return false;
+        }
+        ball_done.wait();
+        return true;
+    };
+
+    // 1. Canny赛场轮廓提取
+    try {
+        {
+            ScopedTimer timer(t, STAGE_GRAY);
+            cvtColor(input, gray_, COLOR_BGR2GRAY);
+        }
+        {
+            ScopedTimer timer(t, STAGE_BLUR);
+            GaussianBlur(gray_, blurred_, Size(5, 5), 1.3);
+        }
+        {
+            ScopedTimer timer(t, STAGE_CANNY);
+            Canny(blurred_, edges_, 50, 150);
+        }
+        
+        ScopedTimer timer(t, STAGE_CONTOURS);
+        findContours(edges_, contours_, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+        
+        visualization_.create(input.size(), CV_8UC1);
+        visualization_.setTo(Scalar(0));
+        drawContours(visualization_, contours_, -1, Scalar(255), 2);
+
+        erode(visualization_, eroded_, kernel1_);
+        dilate(eroded_, visualization_, kernel2_);
+    } catch (...) {
+        // 弹丸分支正在使用成员缓冲区，必须先等它结束；未开始的直接作废
+        if (pool_ && ball_claimed->exchange(true)) ball_done.wait();
+        throw;
+    }
+
+    if (pool_) {
+        if (join_ball_branch()) ball_done.get();  // 传递分支内抛出的异常
+    } else {
+        ball_branch();
+    }
+
+    int validBalls = 0;
+    Mat originalMarked;
+    ScopedTimer filter_timer(t, STAGE_BALL_FILTER);
+    if (detail) cvtColor(visualization_, originalMarked, COLOR_GRAY2BGR);
+
+    // 初始化数据包
+    memset(&pkt, 0, sizeof(MqttPacket));
+
+    for (const auto &cnt : ballContours_) {
+        double area = contourArea(cnt);
+        if (area < MIN_BALL_AREA || area > MAX_BALL_AREA) continue;
+        double perim = arcLength(cnt, true);
+        if (perim <= 0) continue;
+        double circularity = 4.0 * CV_PI * area / (perim * perim);
+        if (circularity < MIN_BALL_CIRCULARITY) continue;
+        Rect rect = boundingRect(cnt);
+        double aspect = static_cast<double>(rect.width) / rect.height;
+        if (aspect < 1.0) aspect = 1.0 / aspect;
+        if (aspect > MAX_BALL_ASPECT_RATIO) continue;
+
+        // 记录弹丸信息
+        Point2f center;
+        float radius;
+        minEnclosingCircle(cnt, center, radius);
+        if (detail) {
+            detail->ballCenters.push_back(center);
+            detail->ballRadii.push_back(radius);
+
+            // 原始画面标记
+            circle(originalMarked, center, (int)radius, Scalar(255, 255, 255), -1);
+            circle(originalMarked, center, (int)radius + 3, Scalar(0, 255, 0), 3);
+        }
+
+        if (validBalls < 4) {
+            pkt.balls[validBalls].x = (uint8_t)cvRound(center.x * TARGET_SIZE.width / origW);
+            pkt.balls[validBalls].y = (uint8_t)cvRound(center.y * TARGET_SIZE.height / origH);
+            pkt.balls[validBalls].r = (uint8_t)cvRound(radius * TARGET_SIZE.width / origW);
+            validBalls++;
+        } else if (!detail) {
+            break;
+        }
+    }
+
+    // 合并弹丸像素
+    bitwise_or(visualization_, greenMask_, visualization_);
+    filter_timer.stop();
+
+    // 缩放+RLE压缩
+    {
+        ScopedTimer timer(t, STAGE_RESIZE);
+        resize(visualization_, resized_, TARGET_SIZE, 0, 0, INTER_LINEAR);
+        threshold(resized_, binary_, 128, 255, THRESH_BINARY);
+    }
+    
+    ScopedTimer encode_timer(t, STAGE_ENCODE);
+    pkt.config = CFG_VALID;
+    pkt.width = TARGET_SIZE.width;
+    pkt.height = TARGET_SIZE.height;
+    int rle_len = compressRLE(binary_, pkt.rle_data, RLE_DATA_MAX_BYTE);
+    if (rle_len >= RLE_DATA_MAX_BYTE) pkt.config |= CFG_TRUNCATED;
+    packet_set_payload(pkt, rle_len, resync_rows_ > 0 ? CODEC_RLE_SYNC : CODEC_RLE);
+    packet_seal(pkt);
+    encode_timer.stop();
+
+    if (detail) {
+        detail->finalBinary = binary_.clone();
+        detail->originalMarked = originalMarked;
+        detail->ballCount = validBalls;
+    }
+    return rle_len;
+}
+
+ProcessResult HeroCamCompressor::process(FrameEnvelope& frame) {
+    TraceScope trace("process", frame.meta.source_seq);
+    frame.meta.process_start_us = monotonic_us();
+    ProcessResult result = process(frame.image);
+    frame.meta.process_end_us = monotonic_us();
+    result.meta = frame.meta;
+    result.packet.config |= (frame.meta.stream_id << CFG_STREAM_SHIFT) & CFG_STREAM_MASK;
+    packet_set_capture_ts(result.packet, frame.meta.capture_us);
+    return result;
+}
+
+int HeroCamCompressor::compressRLE(const Mat& img, uint8_t* out_buf, int max_len) {
+    int buf_idx = 0;
+    const uchar *ptr = img.data;
+    int total = img.rows * img.cols;
+    // 分段：每resync_rows_行一段，游程不跨段，段首写同步标记；不分段时整幅图为一段
+    int seg_pixels = resync_rows_ > 0 ? resync_rows_ * img.cols : total;
+    int seg_end = min(seg_pixels, total);
+    for (int i = 0; i < total && buf_idx + 1 < max_len; ) {
+        if (i == seg_end) {
+            out_buf[buf_idx++] = 0;
+            out_buf[buf_idx++] = (uint8_t)(i / img.cols);
+            seg_end = min(seg_end + seg_pixels, total);
+            continue;
+        }
+        uchar val = (ptr[i] > 128) ? 1 : 0; 
+        uint8_t count = 1;
+        while (i + count < seg_end &&
+               ((ptr[i + count] > 128 ? 1 : 0) == val) &&
+               count < 255 &&
+               buf_idx + 1 < max_len)
+            count++;
+        out_buf[buf_idx++] = count;
+        out_buf[buf_idx++] = val;
+        i += count;
+    }
+    return buf_idx;
+}
+
+// ============ 包头校验 ============
+// CRC-8（多项式0x07），按字节查表
+struct Crc8Table {
+    uint8_t t[256];
+    Crc8Table() {
+        for (int i = 0; i < 256; i++) {
+            uint8_t c = (uint8_t)i;
+            for (int b = 0; b < 8; b++) c = (uint8_t)((c & 0x80) ? (c << 1) ^ 0x07 : c << 1);
+            t[i] = c;
+        }
+    }
+};
+static const Crc8Table CRC8_TABLE;
+
+static uint8_t crc8(uint8_t crc, const uint8_t* data, int len) {
+    for (int i = 0; i < len; i++) crc = CRC8_TABLE.t[crc ^ data[i]];
+    return crc;
+}
+
+static uint8_t packet_checksum(const MqttPacket& pkt, int payload_len) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&pkt);
+    uint8_t crc = crc8(0, p, HEADER_BYTE);
+    crc = crc8(crc, pkt.rle_data, payload_len);
+    return crc8(crc, pkt.reserved, RESERVED_CHECKSUM_OFFSET);
+}
+
+void packet_seal(MqttPacket& pkt) {
+    int len = min(packet_payload_len(pkt), RLE_DATA_MAX_BYTE);
+    pkt.reserved[RESERVED_CHECKSUM_OFFSET] = packet_checksum(pkt, len);
+}
+
+bool packet_validate(const MqttPacket& pkt, int& payload_len) {
+    uint8_t version = pkt.reserved[RESERVED_VERSION_OFFSET];
+    if (version == 0) {
+        // 旧格式：无长度与校验信息，保留区应全为0；否则更可能是版本字节被破坏的新格式包
+        for (int i = RESERVED_VERSION_OFFSET + 1; i < RESERVED_BYTE; i++) {
+            if (pkt.reserved[i] != 0) return false;
+        }
+        payload_len = RLE_DATA_MAX_BYTE;
+        return true;
+    }
+    uint8_t codec = pkt.reserved[RESERVED_CODEC_OFFSET];
+    if (version != PACKET_VERSION || (codec != CODEC_RLE && codec != CODEC_RLE_SYNC)) return false;
+    int len = packet_payload_len(pkt);
+    if (len > RLE_DATA_MAX_BYTE) return false;
+    if (packet_checksum(pkt, len) != pkt.reserved[RESERVED_CHECKSUM_OFFSET]) return false;
+    payload_len = len;
+    return true;
+}
+
+// ============ 辅助函数实现 ============
+Mat decodeRLE(const uint8_t* rle_data, int rle_len, Size sz) {
+    Mat decoded;
+    decodeRLEInto(rle_data, rle_len, sz, decoded);
+    return decoded;
+}
+
+void decodeRLEInto(const uint8_t* rle_data, int rle_len, Size sz, Mat& out) {
+    out.create(sz, CV_8UC1);  // 尺寸类型不变时复用已有缓冲区
+    uchar *ptr = out.data;
+    int pixelIdx = 0;
+    int totalPixels = sz.width * sz.height;
+    for (int i = 0; i + 1 < rle_len && pixelIdx < totalPixels; i += 2) {
+        int count = min((int)rle_data[i], totalPixels - pixelIdx);
+        memset(ptr + pixelIdx, rle_data[i + 1] == 1 ? 255 : 0, count);
+        pixelIdx += count;
+    }
+    // 截断或填充部分补黑
+    if (pixelIdx < totalPixels) memset(ptr + pixelIdx, 0, totalPixels - pixelIdx);
+}
+
+// 计数为0的字节对是同步标记：下一像素从标记给出的行首开始，中间缺的部分补黑
+static void decodeRLESyncInto(const uint8_t* rle_data, int rle_len, Size sz, Mat& out) {
+    out.create(sz, CV_8UC1);
+    uchar *ptr = out.data;
+    int pixelIdx = 0;
+    int totalPixels = sz.width * sz.height;
+    for (int i = 0; i + 1 < rle_len; i += 2) {
+        if (rle_data[i] == 0) {
+            int target = min(rle_data[i + 1] * sz.width, totalPixels);
+            if (target > pixelIdx) {
+                memset(ptr + pixelIdx, 0, target - pixelIdx);
+                pixelIdx = target;
+            }
+            continue;
+        }
+        if (pixelIdx >= totalPixels) break;
+        int count = min((int)rle_data[i], totalPixels - pixelIdx);
+        memset(ptr + pixelIdx, rle_data[i + 1] == 1 ? 255 : 0, count);
+        pixelIdx += count;
+    }
+    if (pixelIdx < totalPixels) memset(ptr + pixelIdx, 0, totalPixels - pixelIdx);
+}
+
+void decodePacketInto(const MqttPacket& pkt, int payload_len, Mat& out) {
+    if (pkt.reserved[RESERVED_CODEC_OFFSET] == CODEC_RLE_SYNC) {
+        decodeRLESyncInto(pkt.rle_data, payload_len, TARGET_SIZE, out);
+    } else {
+        decodeRLEInto(pkt.rle_data, payload_len, TARGET_SIZE, out);
+    }
+}
+
+int decodeDamagedInto(const MqttPacket& pkt, Mat& out) {
+    if (pkt.reserved[RESERVED_VERSION_OFFSET] != PACKET_VERSION ||
+        pkt.reserved[RESERVED_CODEC_OFFSET] != CODEC_RLE_SYNC) {
+        return -1;
+    }
+    const int width = TARGET_SIZE.width;
+    const int height = TARGET_SIZE.height;
+    if (out.rows != height || out.cols != width || out.type() != CV_8UC1) {
+        out.create(TARGET_SIZE, CV_8UC1);
+        out.setTo(Scalar(0));
+    }
+    const uint8_t* d = pkt.rle_data;
+    int len = min(packet_payload_len(pkt), RLE_DATA_MAX_BYTE) & ~1;
+    int rows = 0;
+    int seg_start = 0;   // 分段在载荷中的起始偏移
+    int seg_row = 0;     // 分段起始行
+    for (int i = 0; i <= len; i += 2) {
+        bool at_end = i == len;
+        if (!at_end && d[i] != 0) continue;
+        int next_row = at_end ? height : d[i + 1];
+        // 游程总数恰好填满到下一个同步点才认为这一段完好；截断的最后一段同样丢弃
+        int sum = 0;
+        for (int k = seg_start; k < i; k += 2) sum += d[k];
+        if (seg_row < next_row && next_row <= height && sum == (next_row - seg_row) * width) {
+            uchar* ptr = out.data + seg_row * width;
+            for (int k = seg_start; k < i; k += 2) {
+                memset(ptr, d[k + 1] == 1 ? 255 : 0, d[k]);
+                ptr += d[k];
+            }
+            rows += next_row - seg_row;
+        }
+        if (at_end) break;
+        seg_start = i + 2;
+        seg_row = d[i + 1];
+    }
+    return rows;
+}
+
+bool createDir(const string& path) {
+    return system(("mkdir -p " + path).c_str()) == 0;
+}
+
+int64_t monotonic_us() {
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
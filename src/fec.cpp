@@ -0,0 +1,86 @@
+#include "fec.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+static void xor_into(uint8_t* acc, const uint8_t* data, int len) {
+    for (int i = 0; i < len; i++) acc[i] ^= data[i];
+}
+
+// ============ FecEncoder 成员函数实现 ============
+FecEncoder::FecEncoder(int group) : group_(min(max(group, 0), MAX_FEC_GROUP)) {
+    memset(acc_, 0, sizeof(acc_));
+}
+
+bool FecEncoder::add(const MqttPacket& pkt, int stream_id, ParityPacket& pp) {
+    if (!enabled()) return false;
+    // 序号不连续（中间有地图包没发出去）时重新开始一组
+    if (count_ > 0 && (uint8_t)(first_seq_ + count_) != pkt.frame_seq) {
+        count_ = 0;
+        memset(acc_, 0, sizeof(acc_));
+    }
+    if (count_ == 0) first_seq_ = pkt.frame_seq;
+    xor_into(acc_, reinterpret_cast<const uint8_t*>(&pkt), TOTAL_PACKET_BYTE);
+    if (++count_ < group_) return false;
+
+    pp.magic = PARITY_PACKET_MAGIC;
+    pp.config = (uint8_t)((stream_id << CFG_STREAM_SHIFT) & CFG_STREAM_MASK);
+    pp.first_seq = first_seq_;
+    pp.count = (uint8_t)count_;
+    memcpy(pp.parity, acc_, sizeof(acc_));
+
+    count_ = 0;
+    memset(acc_, 0, sizeof(acc_));
+    return true;
+}
+
+bool FecEncoder::completes_group(uint8_t frame_seq) const {
+    if (!enabled()) return false;
+    bool contiguous = count_ > 0 && (uint8_t)(first_seq_ + count_) == frame_seq;
+    return (contiguous ? count_ + 1 : 1) >= group_;
+}
+
+// ============ FecDecoder 成员函数实现 ============
+FecDecoder::FecDecoder() { memset(valid_, 0, sizeof(valid_)); }
+
+void FecDecoder::on_map(const MqttPacket& pkt) {
+    slots_[pkt.frame_seq] = pkt;
+    valid_[pkt.frame_seq] = true;
+    valid_[(uint8_t)(pkt.frame_seq + 128)] = false;
+}
+
+bool FecDecoder::on_parity(const ParityPacket& pp, MqttPacket& recovered) {
+    stats_.parity_received++;
+    if (pp.count == 0 || pp.count > MAX_FEC_GROUP) return false;
+
+    int missing = -1;
+    int missing_count = 0;
+    uint8_t acc[TOTAL_PACKET_BYTE];
+    memcpy(acc, pp.parity, sizeof(acc));
+    for (int k = 0; k < pp.count; k++) {
+        uint8_t seq = (uint8_t)(pp.first_seq + k);
+        if (valid_[seq]) {
+            xor_into(acc, reinterpret_cast<const uint8_t*>(&slots_[seq]), TOTAL_PACKET_BYTE);
+        } else {
+            missing = seq;
+            missing_count++;
+        }
+    }
+    if (missing_count == 0) return false;
+    if (missing_count > 1) {
+        stats_.unrecoverable++;
+        return false;
+    }
+
+    memcpy(&recovered, acc, sizeof(recovered));
+    int payload_len;
+    // 组内某个包在途中被改坏但恰好通过了校验时，异或结果对不上，交给包头校验拒绝
+    if (recovered.frame_seq != (uint8_t)missing || !packet_validate(recovered, payload_len)) {
+        stats_.unrecoverable++;
+        return false;
+    }
+    on_map(recovered);
+    stats_.recovered++;
+    return true;
+}
@@ -0,0 +1,87 @@
+#include "hero_api.h"
+#include "header.h"
+#include <new>
+
+using namespace cv;
+
+static_assert(sizeof(MqttPacket) == HERO_PACKET_BYTES, "C接口数据包大小与MqttPacket不一致");
+
+// ============ 句柄 ============
+struct hero_compressor {
+    HeroCamCompressor compressor;
+    Mat converted;        // 非BGR24输入的转换缓冲区，尺寸不变时复用
+    uint8_t stream_bits;  // 预先移位好的config流编号位
+    uint8_t frame_seq;
+};
+
+// ============ C 接口实现 ============
+hero_compressor* hero_compressor_create(int stream_id) {
+    if (stream_id < 0 || stream_id >= MAX_STREAMS) return nullptr;
+    hero_compressor* c = new (std::nothrow) hero_compressor();
+    if (!c) return nullptr;
+    c->stream_bits = (uint8_t)((stream_id << CFG_STREAM_SHIFT) & CFG_STREAM_MASK);
+    c->frame_seq = 0;
+    return c;
+}
+
+void hero_compressor_destroy(hero_compressor* c) {
+    delete c;
+}
+
+int hero_compress_frame(hero_compressor* c,
+                        const uint8_t* data, int width, int height, int stride,
+                        int format, uint8_t* out_packet, hero_frame_info* info) {
+    if (!c || !data || !out_packet || width <= 0 || height <= 0) return HERO_EINVAL;
+
+    int channels;
+    switch (format) {
+    case HERO_FORMAT_BGR24:
+    case HERO_FORMAT_RGB24:  channels = 3; break;
+    case HERO_FORMAT_BGRA32:
+    case HERO_FORMAT_RGBA32: channels = 4; break;
+    default: return HERO_EFORMAT;
+    }
+    if (stride < width * channels) return HERO_EINVAL;
+
+    // 异常不能穿过C ABI
+    try {
+        // 只包装调用者的内存，不拷贝；压缩器只读取输入
+        Mat input(height, width, channels == 3 ? CV_8UC3 : CV_8UC4,
+                  const_cast<uint8_t*>(data), (size_t)stride);
+        const Mat* bgr = &input;
+        if (format != HERO_FORMAT_BGR24) {
+            int code = format == HERO_FORMAT_RGB24 ? COLOR_RGB2BGR :
+                       format == HERO_FORMAT_BGRA32 ? COLOR_BGRA2BGR : COLOR_RGBA2BGR;
+            cvtColor(input, c->converted, code);
+            bgr = &c->converted;
+        }
+
+        MqttPacket& pkt = *reinterpret_cast<MqttPacket*>(out_packet);
+        int balls = 0;
+        int rle_len = c->compressor.encode(*bgr, pkt, &balls);
+        if (rle_len < 0) return HERO_EINVAL;
+        pkt.frame_seq = ++c->frame_seq;
+        pkt.config |= c->stream_bits;
+        packet_seal(pkt);
+
+        if (info) {
+            info->rle_bytes = rle_len;
+            info->ball_count = balls;
+            info->truncated = (pkt.config & CFG_TRUNCATED) ? 1 : 0;
+            info->frame_seq = pkt.frame_seq;
+        }
+        return HERO_OK;
+    } catch (...) {
+        return HERO_EINTERNAL;
+    }
+}
+
+const char* hero_strerror(int code) {
+    switch (code) {
+    case HERO_OK:        return "ok";
+    case HERO_EINVAL:    return "invalid argument";
+    case HERO_EFORMAT:   return "unsupported pixel format";
+    case HERO_EINTERNAL: return "internal error";
+    default:             return "unknown error";
+    }
+}
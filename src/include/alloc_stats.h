@@ -0,0 +1,24 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <cstdint>
+
+// ============ 堆分配统计 ============
+// 以 -DHERO_ALLOC_STATS=ON 构建时，替换全局operator new/delete并为cv::Mat安装计数分配器
+// （cv::Mat的数据区经fastMalloc分配，不走operator new），按线程累计分配次数与字节数。
+// 默认构建下计数恒为0，ScopedTimer中的相关代码被编译期常量消除。
+struct AllocCounters {
+    uint64_t count = 0;    // 分配次数（operator new + Mat数据区）
+    uint64_t bytes = 0;    // 分配字节数
+};
+
+#ifdef HERO_ALLOC_STATS
+constexpr bool ALLOC_STATS_ENABLED = true;
+// 当前线程自启动以来的累计值，差值即某段代码的分配量
+AllocCounters alloc_thread_counters();
+#else
+constexpr bool ALLOC_STATS_ENABLED = false;
+inline AllocCounters alloc_thread_counters() { return AllocCounters(); }
+#endif
+
+#endif // ALLOC_STATS_H
@@ -0,0 +1,49 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "header.h"
+#include <string>
+#include <vector>
+
+// ============ 离线批处理任务 ============
+struct BatchJob {
+    std::string input;        // 视频文件路径
+    std::string output_stem;  // 输出文件前缀（不含扩展名），生成 .pkt 和 .csv
+    long start_frame = 0;     // 处理区间 [start_frame, end_frame)
+    long end_frame = -1;      // -1 表示直到文件结尾
+};
+
+struct BatchResult {
+    std::string input;
+    bool ok = false;
+    std::string error;
+    long frames = 0;          // 编码的帧数
+    long frames_read = 0;     // 读到的帧数（含解码为空、未编码的帧）
+    long packet_bytes = 0;    // 写出的数据包总字节
+    long rle_bytes = 0;       // RLE有效数据总字节
+    int rle_max = 0;
+    long truncated = 0;       // RLE被截断的帧数
+    long ball_frames = 0;     // 检测到弹丸的帧数
+    double decode_sec = 0;    // 视频解码累计耗时
+    double process_sec = 0;   // process()累计耗时
+    double wall_sec = 0;
+};
+
+constexpr long MIN_RANGE_FRAMES = 300;  // 单个区间最少帧数，太短时seek开销不划算
+
+// 顺序处理一个视频文件（或其中一个帧区间），逐帧写数据包流(.pkt，连续的MqttPacket)
+// 与逐帧统计(.csv)；只持有当前一帧，内存占用与视频长度无关。
+// 每个区间使用全新的压缩器，frame_seq按绝对帧号续接，拼接后与不分段处理一致
+BatchResult run_batch_job(const BatchJob& job);
+
+// 把一个文件切成最多 parts 个连续区间，边界按 gop 对齐（seek落在关键帧上，免去从前一关键帧解码的开销）；
+// gop须为视频实际的关键帧间隔，对齐后越过 total_frames 的边界并入最后一段
+std::vector<BatchJob> split_job(const BatchJob& job, long total_frames, int parts, int gop);
+
+// 按区间顺序拼接各分段输出到 output_stem，删除分段文件，并合并统计
+BatchResult merge_ranges(const std::string& output_stem, const std::vector<BatchJob>& ranges,
+                         const std::vector<BatchResult>& parts);
+
+void print_batch_summary(const std::vector<BatchResult>& results, double wall_sec);
+
+#endif // BATCH_H
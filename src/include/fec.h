@@ -0,0 +1,53 @@
+#ifndef FEC_H
+#define FEC_H
+
+#include "header.h"
+
+// ============ 异或校验编码 ============
+// 每group个连续编号的地图包生成一个校验包。组内任意一个地图包丢失（或校验失败）时，
+// 用校验包与其余地图包异或即可恢复；丢两个及以上无法恢复。
+class FecEncoder {
+public:
+    explicit FecEncoder(int group = 0);
+
+    bool enabled() const { return group_ > 0; }
+    // 累加一个已发出的地图包；凑满一组时生成校验包写入parity并返回true
+    bool add(const MqttPacket& pkt, int stream_id, ParityPacket& parity);
+    // 序号为frame_seq的地图包加入后是否凑满一组（发送方据此预留校验包的令牌）
+    bool completes_group(uint8_t frame_seq) const;
+
+private:
+    int group_;
+    int count_ = 0;
+    uint8_t first_seq_ = 0;
+    uint8_t acc_[TOTAL_PACKET_BYTE];
+};
+
+struct FecStats {
+    long parity_received = 0;
+    long recovered = 0;            // 恢复出的地图包
+    long unrecoverable = 0;        // 组内缺两个及以上
+};
+
+// ============ 异或校验解码 ============
+// 每路视频流一个。按frame_seq保存最近收到的完好地图包，校验包到达时检查组内是否恰好缺一个。
+class FecDecoder {
+public:
+    FecDecoder();
+
+    // 收到通过校验的地图包
+    void on_map(const MqttPacket& pkt);
+    // 收到校验包；恢复出组内唯一缺失的地图包时写入recovered并返回true
+    bool on_parity(const ParityPacket& pp, MqttPacket& recovered);
+
+    const FecStats& stats() const { return stats_; }
+    void reset_stats() { stats_ = FecStats(); }
+
+private:
+    // 按frame_seq（模256）索引；收到新包时作废相距半个序号空间的旧项，防止回绕后误用
+    MqttPacket slots_[256];
+    bool valid_[256];
+    FecStats stats_;
+};
+
+#endif // FEC_H
@@ -1,7 +1,9 @@
 #ifndef HEADER_H
 #define HEADER_H
 
+#include "stage_timer.h"
 #include <opencv2/opencv.hpp>
+#include <memory>
 #include <vector>
 #include <cstdint>
 #include <cstring>
@@ -24,6 +26,13 @@ constexpr float MAX_BALL_ASPECT_RATIO = 1.3f;
 const cv::Scalar BALL_HSV_LOW(40, 10, 150);
 const cv::Scalar BALL_HSV_HIGH(95, 255, 255);
 
+// ============ 数据包config位定义 ============
+constexpr uint8_t CFG_VALID = 0x01;        // 有效数据包
+constexpr uint8_t CFG_TRUNCATED = 0x02;    // RLE数据被截断
+constexpr int CFG_STREAM_SHIFT = 4;        // bit4-6：视频流编号
+constexpr uint8_t CFG_STREAM_MASK = 0x70;
+constexpr int MAX_STREAMS = 8;
+
 // ============ 数据结构 ============
 #pragma pack(1)
 struct BallInfo {
@@ -32,6 +41,12 @@ struct BallInfo {
     uint8_t r;  // 小分辨率半径
 };
 
+// 弹丸速度：小分辨率像素/秒，按BALL_VEL_UNIT量化
+struct BallVelocity {
+    int8_t vx;
+    int8_t vy;
+};
+
 struct MqttPacket {
     uint8_t frame_seq;
     uint8_t config;
@@ -41,30 +56,165 @@ struct MqttPacket {
     uint8_t rle_data[RLE_DATA_MAX_BYTE];
     uint8_t reserved[RESERVED_BYTE];
 };
+// 弹丸遥测包：只含弹丸位置与速度，按相机帧率（或更高的插值频率）发送，与地图包各自独立编号
+struct BallPacket {
+    uint8_t magic;                    // BALL_PACKET_MAGIC（接收端按长度区分两种包，magic用于校验）
+    uint8_t config;                   // bit0 插值预测；bit4-6 视频流编号
+    uint16_t seq;                     // 弹丸包序号
+    uint8_t map_seq;                  // 发送时最近一个地图包的frame_seq
+    uint8_t count;                    // 有效弹丸数
+    uint32_t capture_us;              // 采集时刻（monotonic_us低32位）；插值预测包为外推到的时刻
+    BallInfo balls[4];
+    BallVelocity vel[4];              // 与balls一一对应，接收端据此外推到显示时刻
+};
+// FEC校验包：每组若干个地图包之后发送，内容为组内各地图包逐字节异或；同组只丢一个地图包时接收端可恢复
+struct ParityPacket {
+    uint8_t magic;                    // PARITY_PACKET_MAGIC
+    uint8_t config;                   // bit4-6 视频流编号
+    uint8_t first_seq;                // 组内第一个地图包的frame_seq
+    uint8_t count;                    // 组内地图包数（frame_seq连续）
+    uint8_t parity[TOTAL_PACKET_BYTE];
+};
 #pragma pack()
 static_assert(sizeof(MqttPacket) == TOTAL_PACKET_BYTE, "数据包必须严格300字节");
 
+// ============ 保留区布局（包头版本1） ============
+// reserved[0]    版本号，0表示旧格式（保留区未使用，按整个RLE区解码）
+// reserved[1..2] 有效载荷字节数（小端），解码到此为止，不再解码尾部填充
+// reserved[3]    载荷编码
+// reserved[4..7] 采集时刻（monotonic_us低32位），收发两端在同一主机时可直接求单向时延
+// reserved[8]    校验和：CRC-8，覆盖16字节包头、有效载荷与reserved[0..7]
+constexpr uint8_t PACKET_VERSION = 1;
+constexpr uint8_t CODEC_RLE = 1;           // (count, value) 字节对
+constexpr uint8_t CODEC_RLE_SYNC = 2;      // 同上，另在分段起点插入同步标记 (0, 行号)，游程不跨分段
+constexpr int DEFAULT_RESYNC_ROWS = 8;     // 启用同步标记时的建议间隔：每8行一个同步点（hero_bench --codec sync的默认值）
+constexpr int RESERVED_VERSION_OFFSET = 0;
+constexpr int RESERVED_LEN_OFFSET = 1;
+constexpr int RESERVED_CODEC_OFFSET = 3;
+constexpr int RESERVED_TS_OFFSET = 4;
+constexpr int RESERVED_CHECKSUM_OFFSET = 8;
+
+// 重新计算校验和；修改包内任何字段（frame_seq、config、时间戳等）后都要调用
+void packet_seal(MqttPacket& pkt);
+// 校验包头，成功时给出应解码的载荷长度；版本不识别、长度越界或校验和不符返回false。
+// 版本0（旧格式）只在保留区其余字节全为0时接受
+bool packet_validate(const MqttPacket& pkt, int& payload_len);
+
+inline void packet_set_payload(MqttPacket& pkt, int payload_len, uint8_t codec) {
+    uint16_t len = (uint16_t)payload_len;
+    pkt.reserved[RESERVED_VERSION_OFFSET] = PACKET_VERSION;
+    memcpy(pkt.reserved + RESERVED_LEN_OFFSET, &len, sizeof(len));
+    pkt.reserved[RESERVED_CODEC_OFFSET] = codec;
+}
+
+inline int packet_payload_len(const MqttPacket& pkt) {
+    if (pkt.reserved[RESERVED_VERSION_OFFSET] == 0) return RLE_DATA_MAX_BYTE;
+    uint16_t len;
+    memcpy(&len, pkt.reserved + RESERVED_LEN_OFFSET, sizeof(len));
+    return len;
+}
+
+inline void packet_set_capture_ts(MqttPacket& pkt, int64_t capture_us) {
+    // 旧格式包（如早期 .pkt 文件）补上版本1包头，载荷按整个RLE区
+    if (pkt.reserved[RESERVED_VERSION_OFFSET] == 0) packet_set_payload(pkt, RLE_DATA_MAX_BYTE, CODEC_RLE);
+    uint32_t ts = (uint32_t)capture_us;
+    memcpy(pkt.reserved + RESERVED_TS_OFFSET, &ts, sizeof(ts));
+    packet_seal(pkt);
+}
+
+inline uint32_t packet_capture_ts(const MqttPacket& pkt) {
+    if (pkt.reserved[RESERVED_VERSION_OFFSET] == 0) return 0;
+    uint32_t ts;
+    memcpy(&ts, pkt.reserved + RESERVED_TS_OFFSET, sizeof(ts));
+    return ts;
+}
+
+constexpr uint8_t BALL_PACKET_MAGIC = 0xB1;
+constexpr uint8_t BALL_CFG_PREDICTED = 0x01;
+constexpr int BALL_PACKET_BYTE = sizeof(BallPacket);
+constexpr int BALL_VEL_UNIT = 4;           // 速度量化步长（小分辨率像素/秒），可表示约±500像素/秒
+
+constexpr uint8_t PARITY_PACKET_MAGIC = 0xF3;
+constexpr int PARITY_PACKET_BYTE = sizeof(ParityPacket);
+constexpr int MAX_FEC_GROUP = 16;
+constexpr int MAX_PACKET_BYTE = PARITY_PACKET_BYTE;   // 链路上最长的包
+
+// ============ 帧信封 ============
+// 时间戳均为单调时钟微秒（见monotonic_us），0表示该阶段尚未经过
+struct FrameMeta {
+    uint8_t stream_id = 0;         // 所属视频流
+    int64_t capture_us = 0;        // grab()返回时刻
+    uint32_t source_seq = 0;       // 源帧序号（含被跳过的帧）
+    uint32_t skipped = 0;          // 与上一入队帧之间按frame_skip跳过的帧数
+    uint32_t dropped = 0;          // 与上一入队帧之间因解码失败/入队失败丢弃的帧数
+    int64_t retrieve_us = 0;       // 解码完成
+    int64_t enqueue_us = 0;        // 入队
+    int64_t dequeue_us = 0;        // 出队
+    int64_t process_start_us = 0;  // process()开始
+    int64_t process_end_us = 0;    // process()结束
+};
+
+struct FrameEnvelope {
+    cv::Mat image;
+    FrameMeta meta;
+    std::shared_ptr<const void> keepalive;  // image指向外部缓冲区（如共享内存映射）时，持有它直到帧被丢弃
+};
+
 struct ProcessResult {
+    FrameMeta meta;
     cv::Mat finalBinary;
     cv::Mat originalMarked;
     MqttPacket packet;
-    int rle_used_byte;
-    int ballCount;
+    int rle_used_byte = 0;
+    int ballCount = 0;
     std::vector<cv::Point2f> ballCenters;
     std::vector<float> ballRadii;
+    StageTimes stages;             // process()内各阶段耗时
 };
 
 // ============ 核心压缩器类声明 ============
+class ThreadPool;
+
 class HeroCamCompressor {
 public:
+    HeroCamCompressor();
+
     ProcessResult process(cv::Mat& input);
+    // 处理信封中的图像，并把帧元数据（含处理起止时间）带入结果
+    ProcessResult process(FrameEnvelope& frame);
+    // 只生成数据包，不产出可视化图像；中间缓冲区复用，返回RLE字节数，输入为空时返回-1
+    int encode(const cv::Mat& input, MqttPacket& pkt, int* ball_count = nullptr);
+    // 设置后，轮廓分支与HSV弹丸分支并行执行
+    void setThreadPool(ThreadPool* pool) { pool_ = pool; }
+    // 大于0时改用 CODEC_RLE_SYNC，每rows行插入一个同步标记，载荷受损时仍可部分解码
+    void setResyncRows(int rows) { resync_rows_ = rows; }
+    // 按当前同步设置压缩二值图（>128为1），写满max_len即截断，返回写入字节数
+    int compressRLE(const cv::Mat& img, uint8_t* out_buf, int max_len);
 
 private:
-    int compressRLE(const cv::Mat& img, uint8_t* out_buf, int max_len);
+    int encodeFrame(const cv::Mat& input, MqttPacket& pkt, ProcessResult* detail);
+
+    ThreadPool* pool_ = nullptr;
+    int resync_rows_ = 0;
+
+    // 形态学核与逐帧复用的中间缓冲区（同一压缩器不能被多个线程同时使用）
+    cv::Mat kernel1_, kernel2_;
+    cv::Mat gray_, blurred_, edges_, eroded_, visualization_;
+    cv::Mat hsv_, greenMask_;
+    cv::Mat resized_, binary_;
+    std::vector<std::vector<cv::Point>> contours_, ballContours_;
 };
 
 // ============ 辅助函数声明 ============
 cv::Mat decodeRLE(const uint8_t* rle_data, int rle_len, cv::Size sz);
+// 解码到调用方持有的缓冲区，尺寸不变时不分配内存（接收端逐帧调用）
+void decodeRLEInto(const uint8_t* rle_data, int rle_len, cv::Size sz, cv::Mat& out);
+// 按包头中的编码解码载荷，包须已通过packet_validate
+void decodePacketInto(const MqttPacket& pkt, int payload_len, cv::Mat& out);
+// 校验失败的 CODEC_RLE_SYNC 包：只写回自洽的分段（游程总数恰好填满该分段），其余行保留out原内容。
+// 返回恢复的行数，包头不足以定位分段时返回-1
+int decodeDamagedInto(const MqttPacket& pkt, cv::Mat& out);
 bool createDir(const std::string& path);
+int64_t monotonic_us();
 
 #endif // HEADER_H
\ No newline at end of file
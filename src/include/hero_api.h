@@ -0,0 +1,66 @@
+#ifndef HERO_API_H
+#define HERO_API_H
+
+/* ============ 图传压缩器 C 接口 ============
+ * 供机器人控制进程在进程内直接调用，无需另起程序用管道传帧。
+ * 调用路径上不拷贝输入帧（BGR24直接包装为cv::Mat），中间缓冲区在句柄内复用，
+ * 数据包写入调用者提供的 HERO_PACKET_BYTES 字节缓冲区。
+ * 句柄在首帧（或尺寸变化）后每次调用不再自行分配内存；OpenCV内部（Canny、findContours、
+ * 形态学等）仍有少量按调用的堆分配，无法在本库内消除，对分配敏感的调用者需要知晓。
+ * 这一上限由tests/alloc_test.cpp检查。
+ * 同一句柄不能被多个线程同时使用；不同句柄之间互不影响。 */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define HERO_API __attribute__((visibility("default")))
+#else
+#define HERO_API
+#endif
+
+#define HERO_PACKET_BYTES 300
+
+/* 返回码 */
+#define HERO_OK          0
+#define HERO_EINVAL     -1  /* 参数错误（空指针、尺寸或步长不合法） */
+#define HERO_EFORMAT    -2  /* 不支持的像素格式 */
+#define HERO_EINTERNAL  -3  /* 内部处理异常 */
+
+/* 输入像素格式 */
+typedef enum {
+    HERO_FORMAT_BGR24 = 0,
+    HERO_FORMAT_RGB24 = 1,
+    HERO_FORMAT_BGRA32 = 2,
+    HERO_FORMAT_RGBA32 = 3
+} hero_pixel_format;
+
+typedef struct {
+    int rle_bytes;    /* RLE数据区实际使用字节数 */
+    int ball_count;   /* 写入数据包的弹丸数（最多4） */
+    int truncated;    /* RLE数据是否被截断 */
+    uint8_t frame_seq;
+} hero_frame_info;
+
+typedef struct hero_compressor hero_compressor;
+
+/* stream_id 写入数据包config位（0-7），失败返回NULL */
+HERO_API hero_compressor* hero_compressor_create(int stream_id);
+HERO_API void hero_compressor_destroy(hero_compressor* c);
+
+/* 压缩一帧。data按行存放，stride为行字节数；out_packet至少HERO_PACKET_BYTES字节。
+ * info可为NULL。成功返回HERO_OK，失败时out_packet内容未定义 */
+HERO_API int hero_compress_frame(hero_compressor* c,
+                                 const uint8_t* data, int width, int height, int stride,
+                                 int format, uint8_t* out_packet, hero_frame_info* info);
+
+HERO_API const char* hero_strerror(int code);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HERO_API_H */
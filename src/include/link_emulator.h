@@ -0,0 +1,87 @@
+#ifndef LINK_EMULATOR_H
+#define LINK_EMULATOR_H
+
+#include "sender.h"
+#include <deque>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+// ============ 链路参数 ============
+// 模拟裁判系统图传链路：瓶颈带宽 + 有限队列 + 丢包（可成串） + 固定时延与抖动 + 乱序
+struct LinkProfile {
+    std::string name = "clean";
+    long bandwidth = 0;            // 瓶颈带宽（字节/秒），0表示不限
+    int queue = 64;                // 瓶颈队列深度（包），满时丢弃新到的包
+    double loss = 0.0;             // 平均丢包率
+    double burst_len = 1.0;        // 平均连续丢包长度，>1时按Gilbert-Elliott两状态模型成串丢包
+    int latency_ms = 0;            // 固定单向时延
+    int jitter_ms = 0;             // 时延抖动（均匀分布0..jitter）
+    double reorder = 0.0;          // 被额外延后、让后续包超过的概率
+    int reorder_ms = 10;           // 乱序包的额外时延
+};
+
+// 解析 "key=value" 形式的参数（bw/queue/loss/burst/latency/jitter/reorder/reorder_ms/name），
+// 未知键或非法值返回false
+bool parse_link_param(const std::string& kv, LinkProfile& profile);
+// 解析以空白分隔的一组 key=value
+bool parse_link_profile(const std::string& spec, LinkProfile& profile);
+
+struct LinkEmuStats {
+    long offered = 0;              // 进入链路的包
+    long delivered = 0;
+    long queue_drops = 0;          // 瓶颈队列满被丢弃
+    long lost = 0;                 // 按丢包模型丢弃
+    long reordered = 0;            // 被注入乱序的包
+    long bytes_delivered = 0;
+    int max_queue = 0;             // 瓶颈队列峰值深度
+};
+
+// ============ 链路模拟器 ============
+// 以调用方给定的时间推进（可以是monotonic_us，也可以是仿真用的虚拟时钟），随机数种子固定，结果可复现。
+class LinkEmulator {
+public:
+    explicit LinkEmulator(const LinkProfile& profile, unsigned seed = 1);
+
+    // 包在now_us时刻进入链路
+    void push(const OutPacket& pkt, int64_t now_us);
+    // 取出到达时刻不晚于now_us的包（按到达时刻顺序）
+    void poll(int64_t now_us, std::vector<OutPacket>& out);
+    // 最早一个在途包的到达时刻，无在途包时返回-1
+    int64_t next_delivery_us() const;
+
+    const LinkProfile& profile() const { return profile_; }
+    const LinkEmuStats& stats() const { return stats_; }
+
+private:
+    struct InFlight {
+        int64_t deliver_us;
+        long order;                // 同一时刻到达时保持进入顺序
+        OutPacket pkt;
+        bool operator>(const InFlight& o) const {
+            return deliver_us != o.deliver_us ? deliver_us > o.deliver_us : order > o.order;
+        }
+    };
+
+    bool lose_packet();
+
+    LinkProfile profile_;
+    std::mt19937 rng_;
+    std::uniform_real_distribution<double> uniform_{0.0, 1.0};
+    bool burst_state_ = false;     // Gilbert-Elliott：处于丢包串中
+    double p_enter_ = 0.0;
+    double p_exit_ = 1.0;
+
+    int64_t link_free_us_ = 0;     // 瓶颈链路空闲时刻
+    int64_t last_fifo_us_ = 0;     // 非乱序包的最晚到达时刻，保证FIFO
+    std::deque<int64_t> queued_;   // 瓶颈队列中各包的发完时刻
+    std::priority_queue<InFlight, std::vector<InFlight>, std::greater<InFlight>> in_flight_;
+    long order_ = 0;
+
+    LinkEmuStats stats_;
+};
+
+void print_link_emu_stats(const LinkEmuStats& stats, const LinkProfile& profile);
+
+#endif // LINK_EMULATOR_H
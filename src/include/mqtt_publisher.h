@@ -0,0 +1,128 @@
+#ifndef MQTT_PUBLISHER_H
+#define MQTT_PUBLISHER_H
+
+#include "sender.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============ MQTT发布配置 ============
+struct MqttConfig {
+    std::string host = "127.0.0.1";
+    int port = 1883;
+    std::string topic = "hero";          // 实际主题：<topic>/<流编号>/map、/ball 与 /fec（校验包）
+    std::string client_id = "hero_cam";
+    int queue_depth = 16;                // 待发队列上限，满时丢弃最旧的包
+    int keepalive_s = 10;
+};
+
+// 解析 "host[:port]"
+bool parse_broker(const std::string& spec, MqttConfig& cfg);
+
+struct MqttStats {
+    long published = 0;                  // 已完整写入socket的包数
+    long dropped = 0;                    // 队列满或断线时被丢弃的最旧包
+    long bytes = 0;                      // 写入socket的字节数（含MQTT头）
+    long reconnects = 0;
+    bool connected = false;
+    std::vector<int64_t> latency_us;     // publish()入队到写入socket的耗时
+};
+
+// ============ MQTT 3.1.1 发布者（QoS0） ============
+// publish()只把包放入有界队列后立即返回，不会阻塞流水线；
+// 后台线程用非阻塞socket完成连接、发送、心跳，断线后按退避间隔自动重连。
+class MqttPublisher {
+public:
+    explicit MqttPublisher(const MqttConfig& cfg);
+    ~MqttPublisher();
+
+    MqttPublisher(const MqttPublisher&) = delete;
+    MqttPublisher& operator=(const MqttPublisher&) = delete;
+
+    void publish(const OutPacket& pkt);
+
+    MqttStats stats() const;
+    void reset_stats();
+
+private:
+    enum State { DISCONNECTED, CONNECTING, WAIT_CONNACK, CONNECTED };
+
+    struct Pending {
+        OutPacket pkt;
+        int64_t enqueue_us;
+    };
+
+    void io_loop();
+    bool start_connect();
+    void close_socket(const char* reason);
+    bool flush_output();
+    bool read_input();
+    void fill_output();
+    void wake();
+
+    MqttConfig cfg_;
+    std::string topic_map_[MAX_STREAMS];
+    std::string topic_ball_[MAX_STREAMS];
+    std::string topic_fec_[MAX_STREAMS];
+
+    // 生产者与IO线程共享
+    mutable std::mutex mutex_;
+    std::deque<Pending> queue_;
+    MqttStats stats_;
+
+    // 仅IO线程访问
+    int fd_ = -1;
+    int wake_fd_ = -1;                   // eventfd，publish()时唤醒poll
+    State state_ = DISCONNECTED;
+    std::vector<uint8_t> out_;           // 待写出的字节
+    size_t out_off_ = 0;
+    std::deque<std::pair<size_t, int64_t>> out_marks_;  // out_中每个PUBLISH的结束偏移与入队时刻
+    std::vector<uint8_t> in_;
+    int64_t state_since_us_ = 0;
+    int64_t last_recv_us_ = 0;
+    bool ping_outstanding_ = false;      // 已发PINGREQ，尚未收到PINGRESP
+    int64_t retry_at_us_ = 0;
+    int64_t backoff_us_ = 0;
+    bool warned_ = false;                // 已提示过连接失败，避免重连期间刷屏
+    bool ever_connected_ = false;
+
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+// ============ MQTT 3.1.1 订阅者（接收端） ============
+// 订阅 <topic>/+/map、/ball 与 /fec。单线程使用：receive()内部完成连接、心跳与断线重连，
+// 与UdpReceiver::receive接口一致
+class MqttSubscriber {
+public:
+    explicit MqttSubscriber(const MqttConfig& cfg);
+    ~MqttSubscriber();
+
+    MqttSubscriber(const MqttSubscriber&) = delete;
+    MqttSubscriber& operator=(const MqttSubscriber&) = delete;
+
+    // 等待最多timeout_ms，把收到的包追加到out，返回本次收到的包数
+    int receive(std::vector<OutPacket>& out, int timeout_ms);
+    bool connected() const { return fd_ >= 0; }
+
+private:
+    bool connect_broker();
+    void disconnect(const char* reason);
+    bool send_all(const std::vector<uint8_t>& buf);
+
+    MqttConfig cfg_;
+    int fd_ = -1;
+    std::vector<uint8_t> in_;
+    int64_t last_send_us_ = 0;
+    int64_t last_recv_us_ = 0;
+    int64_t retry_at_us_ = 0;
+    bool warned_ = false;
+};
+
+void print_mqtt_stats(const MqttStats& stats, double elapsed_sec);
+
+#endif // MQTT_PUBLISHER_H
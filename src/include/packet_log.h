@@ -0,0 +1,95 @@
+#ifndef PACKET_LOG_H
+#define PACKET_LOG_H
+
+#include "sender.h"
+#include <string>
+#include <vector>
+
+// ============ 包日志文件布局 ============
+// 只追加的二进制日志，记录实际发出的每个数据包，用于复盘与回放。
+// 布局：PacketLogHeader | 记录区 | 索引区。每条记录为 PacketLogRecord + 数据包字节，按8字节对齐。
+// 写端通过预分配文件的内存映射写入，追加一条记录只是一次memcpy；空间用完时按倍数扩展。
+// 每写一条记录都更新文件头的record_count/data_end，进程异常退出后日志依然可读（只是缺索引）。
+constexpr uint32_t PACKET_LOG_MAGIC = 0x4C504B48;         // "HKPL"
+constexpr uint32_t PACKET_LOG_VERSION = 1;
+constexpr int PACKET_LOG_INDEX_STRIDE = 64;               // 每64条记录一个索引项
+constexpr size_t PACKET_LOG_PREALLOC = 16 << 20;          // 初始预分配16MB
+
+struct PacketLogHeader {
+    uint32_t magic;
+    uint32_t version;
+    int64_t start_us;            // 第一条记录的时间戳
+    uint64_t record_count;
+    uint64_t data_end;           // 记录区结束偏移
+    uint64_t index_offset;       // 索引区偏移，0表示未正常关闭
+    uint64_t index_count;
+    uint8_t pad[16];
+};
+
+struct PacketLogRecord {
+    int64_t timestamp_us;        // 发出时刻（monotonic_us）
+    uint8_t stream_id;
+    uint8_t type;                // OutPacket::Type
+    uint16_t length;             // 数据包字节数
+    uint32_t reserved;
+};
+
+struct PacketLogIndexEntry {
+    int64_t timestamp_us;
+    uint64_t offset;             // 记录在文件中的偏移
+};
+
+static_assert(sizeof(PacketLogHeader) == 64, "PacketLogHeader必须64字节");
+static_assert(sizeof(PacketLogRecord) == 16, "PacketLogRecord必须16字节");
+
+// ============ 写端 ============
+class PacketLogWriter {
+public:
+    ~PacketLogWriter();
+    bool open(const std::string& path, size_t prealloc_bytes = PACKET_LOG_PREALLOC);
+    bool append(const OutPacket& pkt, int64_t timestamp_us);
+    // 写入索引并把文件截断到实际长度
+    void close();
+
+    bool is_open() const { return base_ != nullptr; }
+    uint64_t records() const;
+    uint64_t bytes() const;
+
+private:
+    bool grow(size_t need);
+
+    std::string path_;
+    int fd_ = -1;
+    uint8_t* base_ = nullptr;
+    size_t capacity_ = 0;
+    std::vector<PacketLogIndexEntry> index_;
+};
+
+// ============ 读端 ============
+class PacketLogReader {
+public:
+    ~PacketLogReader();
+    bool open(const std::string& path);
+    void close();
+
+    // 顺序读取下一条记录，读完返回false
+    bool next(OutPacket& pkt, int64_t& timestamp_us);
+    // 定位到第一条时间戳不早于timestamp_us的记录
+    void seek(int64_t timestamp_us);
+    void rewind();
+
+    uint64_t records() const { return header_ ? header_->record_count : 0; }
+    int64_t start_us() const { return header_ ? header_->start_us : 0; }
+    int64_t end_us() const { return last_us_; }
+
+private:
+    const PacketLogHeader* header_ = nullptr;
+    const uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    uint64_t data_end_ = 0;
+    uint64_t pos_ = 0;
+    int64_t last_us_ = 0;
+    std::vector<PacketLogIndexEntry> index_;
+};
+
+#endif // PACKET_LOG_H
@@ -0,0 +1,119 @@
+#ifndef SENDER_H
+#define SENDER_H
+
+#include "fec.h"
+#include "header.h"
+#include <vector>
+
+// ============ 待发送数据包 ============
+struct OutPacket {
+    enum Type { MAP, BALL, PARITY };
+    Type type;
+    int stream_id;
+    int len;
+    uint8_t data[MAX_PACKET_BYTE];
+};
+
+// 按长度和magic还原包类型与流编号（UDP数据报、MQTT消息、包日志共用）；不是合法包时返回false
+bool classify_packet(const uint8_t* data, int len, OutPacket& pkt);
+
+// ============ 令牌桶 ============
+// 按 rate 字节/秒 积累令牌，最多积累 burst 字节；发包前扣除令牌，不足时不发（不排队）
+class TokenBucket {
+public:
+    explicit TokenBucket(long rate_bytes_per_sec = 0, long burst_bytes = 0);
+
+    bool enabled() const { return rate_ > 0; }
+    long rate() const { return (long)rate_; }
+    // 当前令牌不少于bytes
+    bool available(int bytes, int64_t now_us);
+    // 令牌足够时扣除并返回true，不足时不扣除
+    bool consume(int bytes, int64_t now_us);
+
+private:
+    void refill(int64_t now_us);
+
+    double rate_;
+    double burst_;
+    double tokens_;
+    int64_t last_us_ = 0;
+};
+
+// 令牌桶容量下限：凑满一组的地图包要连同校验包一起发出，并且发完还够下一个弹丸包
+constexpr long MIN_BURST_BYTES = TOTAL_PACKET_BYTE + PARITY_PACKET_BYTE + BALL_PACKET_BYTE;
+
+// ============ 双速率发送配置 ============
+struct SenderConfig {
+    double map_rate_hz = 5.0;         // 地图包最高频率
+    double ball_rate_hz = 0.0;        // 弹丸包频率，0表示每处理一帧发一次；高于帧率时在帧间插值补发
+    long budget_bytes_per_sec = 0;    // 总带宽预算，0表示不限
+    long burst_bytes = MIN_BURST_BYTES;  // 每路视频流的令牌桶容量
+    int fec_group = 0;                // 每N个地图包发一个异或校验包，0表示不发
+};
+
+struct SenderStats {
+    long map_packets = 0;
+    long ball_packets = 0;
+    long predicted_packets = 0;       // 帧间插值补发的弹丸包
+    long deferred_maps = 0;           // 地图包到期但令牌不足、改发弹丸包的帧
+    long skipped_frames = 0;          // 令牌连弹丸包都不够、什么都没发的帧
+    long parity_packets = 0;
+    long parity_skipped = 0;          // 令牌不足未发的校验包
+    long bytes = 0;
+};
+
+// ============ 双速率发送器 ============
+// 弹丸位置时效性最强，每帧（或更高频率）发送小的弹丸包；赛场地图变化慢，按较低频率发送完整地图包。
+// 地图包自带弹丸位置，发出地图包的那一帧不再单独发弹丸包。
+// 配置了带宽预算时，每帧按令牌桶决定发完整地图包、只发弹丸包还是什么都不发；
+// 不发的数据直接丢弃，下次用最新一帧重试，不会积压过期数据。
+class DualRateSender {
+public:
+    explicit DualRateSender(const SenderConfig& cfg = SenderConfig());
+
+    // 多路视频共用一条链路时，设置共享令牌桶；未设置时按cfg.budget_bytes_per_sec使用自己的令牌桶
+    void setTokenBucket(TokenBucket* bucket) { shared_bucket_ = bucket; }
+
+    // 处理完一帧后调用，把本帧应发送的包追加到 out
+    void on_frame(const ProcessResult& result, int64_t now_us, std::vector<OutPacket>& out);
+    // 帧间定时调用：ball_rate_hz 高于帧率时按最近两帧的弹丸运动外推补发
+    void poll(int64_t now_us, std::vector<OutPacket>& out);
+
+    double map_rate_hz() const { return cfg_.map_rate_hz; }
+    const SenderStats& stats() const { return stats_; }
+    void reset_stats() { stats_ = SenderStats(); }
+
+private:
+    void update_velocity();
+    void emit_ball(int64_t now_us, bool predicted, std::vector<OutPacket>& out);
+    void emit_parity(const MqttPacket& pkt, int64_t now_us, std::vector<OutPacket>& out);
+
+    TokenBucket* bucket() { return shared_bucket_ ? shared_bucket_ : own_bucket_.enabled() ? &own_bucket_ : nullptr; }
+
+    SenderConfig cfg_;
+    TokenBucket own_bucket_;
+    TokenBucket* shared_bucket_ = nullptr;
+    FecEncoder fec_;
+    int64_t map_interval_us_;
+    int64_t ball_interval_us_;
+    int64_t next_map_us_ = 0;
+    int64_t next_ball_us_ = 0;
+
+    uint8_t map_seq_ = 0;
+    uint16_t ball_seq_ = 0;
+    int stream_id_ = 0;
+
+    // 最近两帧的弹丸观测及由此估计的速度（小分辨率像素/秒），用于外推补发和随包下发
+    BallInfo balls_[4];
+    int ball_count_ = 0;
+    BallInfo prev_balls_[4];
+    int prev_count_ = 0;
+    double vel_x_[4] = {0, 0, 0, 0};
+    double vel_y_[4] = {0, 0, 0, 0};
+    int64_t capture_us_ = 0;
+    int64_t prev_capture_us_ = 0;
+
+    SenderStats stats_;
+};
+
+#endif // SENDER_H
@@ -0,0 +1,90 @@
+#ifndef SHM_FRAME_H
+#define SHM_FRAME_H
+
+#include "header.h"
+#include <atomic>
+#include <string>
+#include <memory>
+
+// ============ 共享内存帧环形缓冲区布局 ============
+// 写端（自瞄主进程或hero_shm_writer）把帧写入POSIX共享内存 /NAME，读端原地读取，不拷贝、不解码。
+// 布局：ShmRingHeader | slot 0 | slot 1 | ...，每个slot为 ShmSlotHeader + 像素数据。
+// 第n帧（n从1开始）写入 slot[n % slot_count]。每个slot用seq做seqlock：
+// 写端先把seq置0，写完数据后再写入帧序号；读端处理前后各读一次seq，两次一致才算有效。
+constexpr uint32_t SHM_MAGIC = 0x46524D48;  // "HMRF"
+constexpr uint32_t SHM_VERSION = 1;
+constexpr int SHM_REATTACH_MS = 1000;       // 超过该时间无新帧时检查写端是否重建了共享内存
+
+struct ShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_bytes;                 // 每个slot像素区容量
+    std::atomic<uint64_t> generation;    // 写端每次启动加1，读端据此发现重启
+    std::atomic<uint64_t> write_seq;     // 最近写完的帧序号，0表示尚无帧
+    uint8_t pad[32];
+};
+
+struct ShmSlotHeader {
+    std::atomic<uint64_t> seq;           // 0表示正在写
+    int64_t timestamp_us;                // 写端采集时刻（CLOCK_MONOTONIC，与monotonic_us同一时钟）
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    int32_t type;                        // OpenCV类型，当前只支持CV_8UC3(BGR)
+    uint32_t size;                       // 有效像素字节数
+    uint8_t pad[28];
+};
+
+static_assert(sizeof(ShmRingHeader) == 64, "ShmRingHeader必须64字节");
+static_assert(sizeof(ShmSlotHeader) == 64, "ShmSlotHeader必须64字节");
+
+// ============ 写端 ============
+class ShmFrameWriter {
+public:
+    ~ShmFrameWriter();
+    // 创建或复用 /name；已存在且容量足够时复用并递增generation（视为写端重启）
+    bool open(const std::string& name, int slot_count, size_t slot_bytes);
+    bool write(const cv::Mat& frame, int64_t timestamp_us);
+    void close();
+
+private:
+    std::string name_;
+    void* base_ = nullptr;
+    size_t map_size_ = 0;
+    uint64_t seq_ = 0;
+};
+
+// ============ 读端 ============
+class ShmFrameReader {
+public:
+    ~ShmFrameReader();
+    bool attach(const std::string& name);
+    void detach();
+
+    // 等待比上次更新的最新一帧；成功时 frame.image 直接指向共享内存（只读映射，不可写入），
+    // frame.keepalive 持有该映射，写端重建后旧映射在最后一个引用它的帧丢弃时解除；
+    // frame.meta.source_seq 为帧序号低32位，skipped 为两次读取之间被覆盖的帧数。
+    // slot头中的尺寸/类型/步长不合法（超出slot容量或不是CV_8UC3）的帧被跳过
+    bool next(FrameEnvelope& frame, int timeout_ms);
+    // 处理完成后调用（可在其他线程）：该帧所在slot未被写端覆盖才返回true
+    bool still_valid(const FrameEnvelope& frame) const;
+
+    uint64_t generation() const { return generation_; }
+
+private:
+    bool reattach_if_replaced();
+    ShmSlotHeader* slot(uint64_t seq) const;
+
+    std::string name_;
+    void* base_ = nullptr;
+    size_t map_size_ = 0;
+    std::shared_ptr<const void> mapping_;  // 持有base_的映射，析构时munmap
+    unsigned long inode_ = 0;
+    uint64_t generation_ = 0;
+    uint64_t last_seq_ = 0;
+    int64_t last_frame_us_ = 0;
+    bool warned_bad_slot_ = false;
+};
+
+#endif // SHM_FRAME_H
@@ -0,0 +1,107 @@
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+#include "alloc_stats.h"
+#include "tracer.h"
+#include <cstdint>
+
+// ============ 流水线阶段 ============
+// STAGE_ENCODE及之前在process()内部计时，由压缩器写入ProcessResult；其余由调度线程计时
+enum Stage {
+    STAGE_GRAY = 0,      // cvtColor灰度
+    STAGE_BLUR,          // GaussianBlur
+    STAGE_CANNY,         // Canny
+    STAGE_CONTOURS,      // 轮廓提取、绘制与形态学
+    STAGE_HSV,           // HSV弹丸分支（与轮廓分支并行时单独计时）
+    STAGE_BALL_FILTER,   // 弹丸筛选与合并
+    STAGE_RESIZE,        // 缩放+二值化
+    STAGE_ENCODE,        // RLE压缩+包头
+    STAGE_CAPTURE,       // grab到解码完成
+    STAGE_QUEUE,         // 入队到出队
+    STAGE_PROCESS,       // process()整体
+    STAGE_DISPLAY,       // 生成操作手画面+imshow
+    STAGE_RECORD,        // 录制写入
+    STAGE_COUNT
+};
+
+const char* stage_name(int stage);
+
+// 单帧各阶段耗时(us)，未测量的阶段为-1；HERO_ALLOC_STATS构建下另记各阶段在本线程的堆分配
+struct StageTimes {
+    int32_t us[STAGE_COUNT];
+    uint32_t allocs[STAGE_COUNT];
+    uint32_t alloc_bytes[STAGE_COUNT];
+    StageTimes() {
+        for (int i = 0; i < STAGE_COUNT; i++) {
+            us[i] = -1;
+            allocs[i] = 0;
+            alloc_bytes[i] = 0;
+        }
+    }
+};
+
+// ============ 作用域计时器 ============
+// 析构时把经过的微秒数写入times->us[stage]，开启追踪时同时记开始/结束事件；
+// times为空且未开启追踪时不读时钟
+class ScopedTimer {
+public:
+    ScopedTimer(StageTimes* times, int stage)
+        : times_(times), stage_(stage), traced_(trace_enabled()), start_us_(0) {
+        if (times_ || traced_) start_us_ = trace_now_us();
+        if (traced_) traced_ = trace_begin(stage_name(stage_), start_us_);
+        if (ALLOC_STATS_ENABLED && times_) alloc_start_ = alloc_thread_counters();
+    }
+    ~ScopedTimer() { stop(); }
+    // 提前结束计时（阶段不便单独成块时用），之后析构不再写入
+    void stop() {
+        if (!times_ && !traced_) return;
+        if (ALLOC_STATS_ENABLED && times_) {
+            AllocCounters a = alloc_thread_counters();
+            times_->allocs[stage_] = (uint32_t)(a.count - alloc_start_.count);
+            times_->alloc_bytes[stage_] = (uint32_t)(a.bytes - alloc_start_.bytes);
+        }
+        int64_t end_us = trace_now_us();
+        if (times_) times_->us[stage_] = (int32_t)(end_us - start_us_);
+        if (traced_) trace_end(stage_name(stage_), end_us);
+        times_ = nullptr;
+        traced_ = false;
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    StageTimes* times_;
+    int stage_;
+    bool traced_;
+    int64_t start_us_;
+    AllocCounters alloc_start_;
+};
+
+// ============ 延迟直方图 ============
+// HDR风格的固定分桶：小于HIST_SUB_BUCKETS的值逐一成桶，之后每个2的幂区间再等分为
+// HIST_SUB_BUCKETS份，相对误差不超过1/HIST_SUB_BUCKETS。记录为O(1)且不分配内存。
+constexpr int HIST_SUB_BITS = 4;
+constexpr int HIST_SUB_BUCKETS = 1 << HIST_SUB_BITS;
+constexpr int HIST_BUCKETS = (32 - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS;  // 覆盖到2^32 us
+
+class LatencyHistogram {
+public:
+    LatencyHistogram() { reset(); }
+
+    void record(int64_t us);
+    // p取0~100；返回该分位所在桶的上界（不超过实际最大值），无样本时返回0
+    int64_t percentile(double p) const;
+    int64_t max() const { return max_; }
+    long count() const { return count_; }
+    double mean() const { return count_ ? (double)sum_ / count_ : 0.0; }
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+private:
+    uint32_t counts_[HIST_BUCKETS];
+    long count_;
+    int64_t sum_;
+    int64_t max_;
+};
+
+#endif // STAGE_TIMER_H
@@ -2,17 +2,22 @@
 #define THREAD_H
 
 #include "header.h"
+#include "sender.h"
 #include <deque>
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
 
 // ============ 环形缓冲区声明 ============
 class RingBuffer {
 public:
     explicit RingBuffer(int capacity);
-    bool push(cv::Mat&& frame);
-    bool pop(cv::Mat& frame);
+    bool push(FrameEnvelope&& frame);
+    bool pop(FrameEnvelope& frame);
     int size() const;
     int capacity() const;
     bool empty() const;
@@ -23,27 +28,116 @@ private:
     std::atomic<int> size_;
     int head_;
     int tail_;
-    std::vector<cv::Mat> buffer_;
+    std::vector<FrameEnvelope> buffer_;
 };
 
 // ============ 全局变量声明（多线程相关） ============
-extern RingBuffer frame_queue;
-extern std::mutex camera_mutex;
-extern std::condition_variable frame_available;
-extern std::condition_variable queue_not_full;
+extern std::mutex pipeline_mutex;
+extern std::condition_variable frame_available;  // 新帧入队/处理完成时通知调度线程
 extern std::atomic<bool> running;
 extern int frame_skip;  // 跳帧参数：处理每第N帧（1表示不跳）
 
+// 视频文件跳帧达到该值时改用seek，否则逐帧grab跳过
+constexpr int FILE_SEEK_MIN_SKIP = 15;
+
 // ============ 性能统计结构声明 ============
 struct PerfStats {
-    std::vector<long> frame_times;
-    std::vector<int> compressed_sizes;
+    std::vector<long> frame_times;        // 每帧耗时(us)
+    std::vector<int> compressed_sizes;    // RLE压缩后大小
+    std::vector<long> capture_latencies;  // 采集到处理完成的延迟(us)
+    long queue_wait_us = 0;               // 入队到出队的累计等待
+    long skipped = 0;
+    long dropped = 0;
     int total_frames = 0;
-    int log_interval = 30;  // 每30帧输出一次统计
+    LatencyHistogram stages[STAGE_COUNT]; // 各阶段耗时分布(us)，每个统计周期清零
+    uint64_t stage_allocs[STAGE_COUNT] = {};       // 各阶段堆分配累计（HERO_ALLOC_STATS）
+    uint64_t stage_alloc_bytes[STAGE_COUNT] = {};
+};
+
+// ============ 流水线配置 ============
+struct PipelineOptions {
+    std::vector<std::string> sources;  // 纯数字为摄像头编号，否则为视频文件路径
+    int prefetch_depth = 4;    // 帧队列深度，即采集线程最多预解码的帧数
+    bool fast = false;         // 不按源帧率节拍，尽快处理（离线吞吐测试）
+    bool display = true;
+    bool record = false;       // 写output_video.avi和逐帧PNG
+    SenderConfig sender;       // 地图包/弹丸包发送频率、带宽预算与FEC分组
+    int resync_rows = 0;       // 大于0时地图包每N行插入同步标记（CODEC_RLE_SYNC）
+    std::string mqtt_broker;   // host[:port]，为空时不发布
+    std::string mqtt_topic = "hero";
+    std::string udp_target;    // host[:port]，为空时不走UDP
+    std::string packet_log;    // 记录实际发出的数据包，为空时不记录
+    std::string trace_path;    // Chrome trace JSON输出路径，为空时不追踪
+};
+
+// ============ 录制器声明 ============
+class ThreadPool;
+class ShmFrameReader;
+constexpr int MAX_PENDING_WRITES = 8;  // 异步录制在途帧数上限
+
+class FrameRecorder {
+public:
+    explicit FrameRecorder(ThreadPool* pool) : pool_(pool) {}
+    // size为空时（如共享内存源，attach时还不知道画面尺寸）推迟到第一次write()按帧尺寸打开
+    bool open(const std::string& video_path, const std::string& frames_dir,
+              double fps, cv::Size size);
+    void write(const cv::Mat& frame);
+    void close();  // 等待所有异步写盘完成
+
+private:
+    bool open_writer(cv::Size size);
+
+    ThreadPool* pool_;
+    cv::VideoWriter writer_;
+    std::string video_path_;
+    std::string frames_dir_;
+    double fps_ = 30.0;
+    bool open_failed_ = false;
+    int frame_index_ = 0;
+    std::deque<std::future<bool>> pending_writes_;
+};
+
+// ============ 视频流 ============
+// 每路视频源独立的采集线程、帧队列、压缩器与frame_seq序号空间
+struct FrameStream {
+    FrameStream(int stream_id, const std::string& src, int depth, const SenderConfig& sender_cfg);
+
+    int id;
+    std::string source;
+    std::string label;
+    std::string window_name;
+    cv::VideoCapture cap;
+    double fps = 30.0;
+    cv::Size size;
+
+    RingBuffer queue;
+    std::mutex mutex;                        // 保护queue
+    std::condition_variable queue_not_full;
+    std::atomic<bool> eof{false};            // 采集线程已结束
+    std::thread capture_thread;
+
+    HeroCamCompressor compressor;
+    uint8_t frame_seq = 0;
+    std::atomic<bool> busy{false};           // 有帧正在线程池中处理
+    std::future<void> inflight;
+    int64_t next_due_us = 0;                 // 按源帧率节拍的下次派发时刻
+    int64_t frame_interval_us = 33333;
+
+    DualRateSender sender;
+    PerfStats stats;
+    std::unique_ptr<FrameRecorder> recorder;
+    std::unique_ptr<ShmFrameReader> shm;     // 共享内存源（"shm:NAME"）
 };
 
-// ============ 线程函数声明 ============
-void run_single_thread_mode(const std::string& source);
-int camera_thread_func(const std::string& source);
+// ============ 流水线函数声明 ============
+bool is_camera_source(const std::string& source);
+bool is_shm_source(const std::string& source);
+bool open_source(const std::string& source, cv::VideoCapture& cap, double& source_fps);
+void render_operator_view(const ProcessResult& result, cv::Size orig, cv::Mat& displayImg);
+void print_stats(PerfStats& stats, double elapsed_sec, const std::string& label);
+void print_sender_stats(DualRateSender& sender, double elapsed_sec, long budget_bytes_per_sec);
+int camera_thread_func(FrameStream& stream);
+int shm_thread_func(FrameStream& stream);
+int run_pipeline(const PipelineOptions& opt, ThreadPool& pool);
 
 #endif // THREAD_H
\ No newline at end of file
@@ -0,0 +1,101 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// ============ 线程池统计 ============
+struct PoolStats {
+    int threads = 0;
+    long tasks_submitted = 0;
+    long tasks_run = 0;
+    long tasks_stolen = 0;                  // 从其他线程队列窃取执行的任务数
+    double utilisation = 0.0;               // 全部工作线程 忙碌时间 / 墙钟时间
+    std::vector<double> worker_utilisation; // 每个工作线程的利用率
+};
+
+// ============ 工作窃取线程池 ============
+// 整个程序只持有一个实例，压缩器/编解码/录制等都向它提交任务，避免各功能各自开线程把小CPU挤爆。
+// 每个工作线程有自己的双端队列：自己从尾部取，空闲时从其他线程队列头部窃取。
+class ThreadPool {
+public:
+    static constexpr int MAX_THREADS = 32;  // 线程总数上限
+
+    // num_threads <= 0 时取 硬件线程数-1（给采集/显示线程留一个核）
+    // pin_threads 为 true 时把第i个工作线程绑定到第i个CPU
+    explicit ThreadPool(int num_threads = 0, bool pin_threads = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // 提交任务；affinity >= 0 时优先放入对应工作线程的队列（亲和提示，仍可能被窃取）
+    template <class F>
+    std::future<typename std::result_of<F()>::type> submit(F&& f, int affinity = -1);
+
+    // 等待future就绪，等待期间由调用线程帮忙执行待办任务（工作线程内部等待子任务时不会死锁）
+    template <class T>
+    void wait(std::future<T>& fut);
+
+    // 在调用线程执行一个待办任务，没有任务时返回false
+    bool run_one();
+
+    int size() const { return static_cast<int>(workers_.size()); }
+    PoolStats stats() const;
+    void reset_stats();
+
+private:
+    struct Worker {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::thread thread;
+        std::atomic<long> tasks_run{0};
+        std::atomic<long> tasks_stolen{0};
+        std::atomic<long> busy_us{0};
+    };
+
+    void push_task(std::function<void()> task, int affinity);
+    bool pop_task(int self, std::function<void()>& task, bool& stolen);
+    void execute(int self, std::function<void()>& task, bool stolen);
+    void worker_loop(int index);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::atomic<int> pending_{0};
+    std::atomic<unsigned> next_worker_{0};
+    std::atomic<long> tasks_submitted_{0};
+    std::atomic<bool> stop_{false};
+    std::chrono::steady_clock::time_point stats_start_;
+};
+
+void print_pool_stats(const ThreadPool& pool);
+
+// ============ 模板成员实现 ============
+template <class F>
+std::future<typename std::result_of<F()>::type> ThreadPool::submit(F&& f, int affinity) {
+    typedef typename std::result_of<F()>::type R;
+    // packaged_task不可拷贝，std::function需要可拷贝对象，用shared_ptr包一层
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+    std::future<R> fut = task->get_future();
+    push_task([task]() { (*task)(); }, affinity);
+    return fut;
+}
+
+template <class T>
+void ThreadPool::wait(std::future<T>& fut) {
+    while (fut.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (!run_one()) fut.wait_for(std::chrono::microseconds(200));
+    }
+}
+
+#endif // THREAD_POOL_H
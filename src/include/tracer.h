@@ -0,0 +1,61 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// ============ 逐帧事件追踪 ============
+// 各线程把开始/结束事件写进自己的无锁环形缓冲区（单生产者单消费者），
+// 由tracer_poll()/tracer_close()统一导出为Chrome trace JSON（chrome://tracing、Perfetto可直接打开）。
+// 未开启时每个埋点只有一次relaxed原子读；事件名必须是字符串字面量等静态存储的字符串。
+// 缓冲区将满时整段作用域（开始与结束事件）一起丢弃，导出的开始/结束事件始终成对
+constexpr int TRACE_BUFFER_EVENTS = 1 << 16;  // 每线程缓冲事件数（2的幂），写满后丢弃新事件
+
+extern std::atomic<bool> g_trace_enabled;
+
+inline bool trace_enabled() { return g_trace_enabled.load(std::memory_order_relaxed); }
+
+inline int64_t trace_now_us() {
+    // 与monotonic_us()同一时钟，事件可与FrameMeta中的时间戳对照
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 打开输出文件并开始记录；同时安装SIGUSR1处理：收到信号后下一次tracer_poll()落盘
+bool tracer_open(const std::string& path);
+// 导出所有线程缓冲区中的事件并写完JSON数组
+void tracer_close();
+// 在主循环中定期调用：收到SIGUSR1或某线程缓冲区过半时落盘，返回导出的事件数
+long tracer_poll();
+// 给当前线程命名（Perfetto中的线程轨道名），未开启时忽略
+void tracer_set_thread_name(const std::string& name);
+
+// 开始事件，arg>=0时作为帧序号写入；同时为对应的结束事件预留位置，缓冲区不够时整个作用域不记录、返回false。
+// 返回true时必须在同一线程上调用trace_end()
+bool trace_begin(const char* name, int64_t ts_us, int64_t arg = -1);
+void trace_end(const char* name, int64_t ts_us);
+// 计数器事件：value为计数值，id区分同名计数器；不占用为结束事件预留的位置
+void trace_counter_event(const char* name, int64_t ts_us, int64_t value, int id);
+inline void trace_counter(const char* name, int id, int64_t value) {
+    if (trace_enabled()) trace_counter_event(name, trace_now_us(), value, id);
+}
+
+// 作用域追踪：构造时记开始事件，析构时记结束事件；arg>=0时作为帧序号写入开始事件
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, int64_t arg = -1) : name_(nullptr) {
+        if (trace_enabled() && trace_begin(name, trace_now_us(), arg)) name_ = name;
+    }
+    ~TraceScope() {
+        if (name_) trace_end(name_, trace_now_us());
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name_;
+};
+
+#endif // TRACER_H
@@ -0,0 +1,97 @@
+#ifndef UDP_TRANSPORT_H
+#define UDP_TRANSPORT_H
+
+#include "sender.h"
+#include <bitset>
+#include <netinet/in.h>
+#include <string>
+#include <vector>
+
+// ============ UDP直连传输 ============
+// 每个数据报就是一个原始数据包（地图包300字节 / 弹丸包sizeof(BallPacket)字节），不加任何额外头部，
+// 接收端按长度区分包类型。同一轮有多个包待发时用sendmmsg/recvmmsg一次系统调用批量收发。
+constexpr int UDP_BATCH = 32;              // 单次sendmmsg/recvmmsg的最大包数
+constexpr int UDP_DEFAULT_PORT = 9300;
+
+// 解析 "host[:port]"，只接受数字IPv4地址
+bool parse_udp_endpoint(const std::string& spec, sockaddr_in& addr);
+
+struct UdpSendStats {
+    long sent = 0;
+    long bytes = 0;
+    long dropped = 0;                      // 发送缓冲区满（EAGAIN）或发送失败的包
+    long syscalls = 0;
+};
+
+class UdpSender {
+public:
+    ~UdpSender();
+    bool open(const std::string& endpoint);
+    void close();
+    // 非阻塞发送；发送缓冲区满时直接丢弃剩余包，不等待
+    void send(const std::vector<OutPacket>& packets);
+
+    const UdpSendStats& stats() const { return stats_; }
+    void reset_stats() { stats_ = UdpSendStats(); }
+
+private:
+    int fd_ = -1;
+    sockaddr_in addr_;
+    UdpSendStats stats_;
+};
+
+class UdpReceiver {
+public:
+    ~UdpReceiver();
+    bool open(int port);
+    void close();
+    // 等待最多timeout_ms，把收到的包追加到out，返回本次收到的包数；出错返回-1
+    // 长度不符合任何包类型的数据报直接丢弃，计入invalid()
+    int receive(std::vector<OutPacket>& out, int timeout_ms);
+
+    int fd() const { return fd_; }
+    long invalid() const { return invalid_; }
+
+private:
+    int fd_ = -1;
+    long invalid_ = 0;
+    uint8_t bufs_[UDP_BATCH][MAX_PACKET_BYTE + 1];  // 多1字节以识别超长数据报
+};
+
+// ============ 链路质量统计 ============
+// 从包序号推算丢包与乱序，从包内采集时间戳推算单向时延（仅在收发同机、共用单调时钟时有意义）。
+// 地图包frame_seq为8位，弹丸包seq为16位，按各自的序号空间分别跟踪。
+struct LinkStats {
+    long received = 0;
+    long lost = 0;                         // 序号跳变推算的丢包数（乱序迟到的包会回补）
+    long reordered = 0;                    // 迟到的包：序号小于已收到的最大序号且未重复
+    long duplicated = 0;                   // 同一序号再次收到
+    long bytes = 0;
+    std::vector<int64_t> latency_us;       // 采集到接收
+};
+
+class LinkMonitor {
+public:
+    void on_packet(const OutPacket& pkt, int64_t recv_us);
+
+    const LinkStats& stats(int stream_id) const { return stats_[stream_id]; }
+    void reset_stats();
+
+private:
+    struct SeqTracker {
+        static constexpr int WINDOW = 128; // 记录最大序号之前多少个序号的收到情况
+        bool started = false;
+        uint32_t last = 0;                 // 已收到的最大序号
+        std::bitset<WINDOW> missing;       // 第i位：序号last-1-i已按丢包计入、尚未收到
+        void update(uint32_t seq, uint32_t modulo, LinkStats& st);
+    };
+
+    SeqTracker map_seq_[MAX_STREAMS];
+    SeqTracker ball_seq_[MAX_STREAMS];
+    LinkStats stats_[MAX_STREAMS];
+};
+
+void print_udp_send_stats(const UdpSendStats& stats, double elapsed_sec);
+void print_link_stats(const LinkStats& stats, double elapsed_sec, const std::string& label);
+
+#endif // UDP_TRANSPORT_H
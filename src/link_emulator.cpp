@@ -0,0 +1,125 @@
+#include "link_emulator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+bool parse_link_param(const string& kv, LinkProfile& p) {
+    size_t eq = kv.find('=');
+    if (eq == string::npos) return false;
+    string key = kv.substr(0, eq);
+    string val = kv.substr(eq + 1);
+    char* end = nullptr;
+    double v = strtod(val.c_str(), &end);
+    bool numeric = !val.empty() && end && *end == '\0';
+
+    if (key == "name") {
+        p.name = val;
+        return !val.empty();
+    }
+    if (!numeric || v < 0) return false;
+    if (key == "bw") p.bandwidth = (long)v;
+    else if (key == "queue") p.queue = max(1, (int)v);
+    else if (key == "loss" && v <= 1.0) p.loss = v;
+    else if (key == "burst") p.burst_len = max(1.0, v);
+    else if (key == "latency") p.latency_ms = (int)v;
+    else if (key == "jitter") p.jitter_ms = (int)v;
+    else if (key == "reorder" && v <= 1.0) p.reorder = v;
+    else if (key == "reorder_ms") p.reorder_ms = (int)v;
+    else return false;
+    return true;
+}
+
+bool parse_link_profile(const string& spec, LinkProfile& profile) {
+    istringstream in(spec);
+    string kv;
+    while (in >> kv) {
+        if (!parse_link_param(kv, profile)) {
+            cerr << "[错误] 无效的链路参数: " << kv << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============ LinkEmulator 成员函数实现 ============
+LinkEmulator::LinkEmulator(const LinkProfile& profile, unsigned seed)
+    : profile_(profile), rng_(seed) {
+    // 两状态模型：好状态不丢包，坏状态全丢；坏状态平均持续burst_len个包，稳态丢包率等于loss
+    if (profile_.burst_len > 1.0 && profile_.loss > 0 && profile_.loss < 1.0) {
+        p_exit_ = 1.0 / profile_.burst_len;
+        p_enter_ = profile_.loss * p_exit_ / (1.0 - profile_.loss);
+    }
+}
+
+bool LinkEmulator::lose_packet() {
+    if (profile_.loss <= 0) return false;
+    if (p_enter_ <= 0) return uniform_(rng_) < profile_.loss;
+    burst_state_ = burst_state_ ? uniform_(rng_) >= p_exit_ : uniform_(rng_) < p_enter_;
+    return burst_state_;
+}
+
+void LinkEmulator::push(const OutPacket& pkt, int64_t now_us) {
+    stats_.offered++;
+
+    // 瓶颈队列：按带宽逐包串行发出，队列满时丢弃新包（尾丢弃）
+    while (!queued_.empty() && queued_.front() <= now_us) queued_.pop_front();
+    if ((int)queued_.size() >= profile_.queue) {
+        stats_.queue_drops++;
+        return;
+    }
+    int64_t depart_us = now_us;
+    if (profile_.bandwidth > 0) {
+        depart_us = max(now_us, link_free_us_) + (int64_t)pkt.len * 1000000 / profile_.bandwidth;
+        link_free_us_ = depart_us;
+        queued_.push_back(depart_us);
+        stats_.max_queue = max(stats_.max_queue, (int)queued_.size());
+    }
+
+    // 丢包发生在空口上，已占用的带宽不退还
+    if (lose_packet()) {
+        stats_.lost++;
+        return;
+    }
+
+    int64_t deliver_us = depart_us + profile_.latency_ms * 1000L;
+    if (profile_.jitter_ms > 0) deliver_us += (int64_t)(uniform_(rng_) * profile_.jitter_ms * 1000);
+    if (profile_.reorder > 0 && uniform_(rng_) < profile_.reorder) {
+        deliver_us += profile_.reorder_ms * 1000L;
+        stats_.reordered++;
+    } else {
+        // 抖动不改变先后顺序，只有被注入乱序的包会被超过
+        deliver_us = max(deliver_us, last_fifo_us_);
+        last_fifo_us_ = deliver_us;
+    }
+
+    InFlight f;
+    f.deliver_us = deliver_us;
+    f.order = order_++;
+    f.pkt = pkt;
+    in_flight_.push(f);
+}
+
+void LinkEmulator::poll(int64_t now_us, vector<OutPacket>& out) {
+    while (!in_flight_.empty() && in_flight_.top().deliver_us <= now_us) {
+        const InFlight& f = in_flight_.top();
+        out.push_back(f.pkt);
+        stats_.delivered++;
+        stats_.bytes_delivered += f.pkt.len;
+        in_flight_.pop();
+    }
+}
+
+int64_t LinkEmulator::next_delivery_us() const {
+    return in_flight_.empty() ? -1 : in_flight_.top().deliver_us;
+}
+
+void print_link_emu_stats(const LinkEmuStats& stats, const LinkProfile& profile) {
+    cout << "Link [" << profile.name << "]: offered " << stats.offered << ", delivered "
+         << stats.delivered << ", queue drops " << stats.queue_drops << " (max depth "
+         << stats.max_queue << "/" << profile.queue << "), lost " << stats.lost
+         << ", reordered " << stats.reordered << endl;
+}
@@ -0,0 +1,375 @@
+#include "link_emulator.h"
+#include "udp_transport.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+// ============ 链路模拟工具 ============
+// relay：UDP转发，插在 hero_cam --udp 与 hero_receiver --udp 之间，实时施加链路损伤；
+// sim：虚拟时钟下把同一段视频按各种发送模式 × 链路场景跑一遍，输出可复现的对比报告。
+constexpr int64_t SIM_TICK_US = 250;          // 仿真时钟步长
+constexpr int64_t SIM_DRAIN_US = 2000000;     // 最后一帧后继续推进的时间，让在途包到达
+
+static atomic<bool> g_running{true};
+
+static void handle_sigint(int) { g_running = false; }
+
+struct SimMode {
+    string name;
+    SenderConfig sender;
+};
+
+struct SimReport {
+    long frames = 0;
+    long map_sent = 0;
+    long map_delivered = 0;
+    long frames_shown = 0;              // 至少有一个携带该帧数据的包（地图包或弹丸包）到达
+    long deferred_maps = 0;             // 令牌桶不足推迟的地图包
+    long fec_recovered = 0;             // 由校验包恢复的地图包（已计入map_delivered）
+    vector<int64_t> latency_us;         // 采集到到达
+    double map_age_sum_us = 0;          // 每帧时刻接收端正在显示的地图的“年龄”
+    long map_age_samples = 0;
+    LinkEmuStats link;
+};
+
+static void usage(const char* prog) {
+    cerr << "Usage:\n"
+         << "  " << prog << " relay --listen PORT --forward HOST:PORT [key=value ...] [--seed N]\n"
+         << "  " << prog << " sim INPUT(.pkt|video) [--script FILE] [--fps F] [--seed N]\n"
+         << "Link keys: bw(bytes/s) queue(packets) loss burst latency(ms) jitter(ms) reorder reorder_ms\n"
+         << "Script lines: 'mode NAME map-rate=HZ ball-rate=HZ budget=BYTES fec=N' / 'link NAME key=value ...'" << endl;
+}
+
+// ============ 仿真输入 ============
+static bool load_frames(const string& path, double& fps, vector<MqttPacket>& frames) {
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".pkt") == 0) {
+        ifstream in(path, ios::binary);
+        MqttPacket pkt;
+        while (in.read(reinterpret_cast<char*>(&pkt), sizeof(pkt))) frames.push_back(pkt);
+        return !frames.empty();
+    }
+    VideoCapture cap(path);
+    if (!cap.isOpened()) return false;
+    double src_fps = cap.get(CAP_PROP_FPS);
+    if (fps <= 0) fps = src_fps > 0 ? src_fps : 30.0;
+    HeroCamCompressor compressor;
+    Mat image;
+    MqttPacket pkt;
+    while (cap.read(image)) {
+        if (image.empty()) continue;
+        compressor.encode(image, pkt);
+        frames.push_back(pkt);
+    }
+    return !frames.empty();
+}
+
+// ============ 场景脚本 ============
+static bool parse_mode(istringstream& in, SimMode& mode) {
+    string kv;
+    while (in >> kv) {
+        size_t eq = kv.find('=');
+        if (eq == string::npos) return false;
+        string key = kv.substr(0, eq);
+        double v = atof(kv.c_str() + eq + 1);
+        if (key == "map-rate") mode.sender.map_rate_hz = v;
+        else if (key == "ball-rate") mode.sender.ball_rate_hz = v;
+        else if (key == "budget") mode.sender.budget_bytes_per_sec = (long)v;
+        else if (key == "fec") mode.sender.fec_group = min(max((int)v, 0), MAX_FEC_GROUP);
+        else return false;
+    }
+    return true;
+}
+
+static bool load_script(const string& path, vector<SimMode>& modes, vector<LinkProfile>& links) {
+    ifstream in(path);
+    if (!in) {
+        cerr << "[错误] 无法打开场景脚本: " << path << endl;
+        return false;
+    }
+    string line;
+    int line_no = 0;
+    while (getline(in, line)) {
+        line_no++;
+        size_t hash = line.find('#');
+        if (hash != string::npos) line = line.substr(0, hash);
+        istringstream ls(line);
+        string kind, name;
+        if (!(ls >> kind)) continue;
+        bool ok = (bool)(ls >> name);
+        if (ok && kind == "mode") {
+            SimMode m;
+            m.name = name;
+            ok = parse_mode(ls, m);
+            modes.push_back(m);
+        } else if (ok && kind == "link") {
+            LinkProfile p;
+            p.name = name;
+            string rest;
+            getline(ls, rest);
+            ok = parse_link_profile(rest, p);
+            links.push_back(p);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            cerr << "[错误] " << path << ":" << line_no << " 无法解析: " << line << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static void default_scenarios(vector<SimMode>& modes, vector<LinkProfile>& links) {
+    const char* mode_specs[][2] = {
+        {"every-frame", "map-rate=1000"},
+        {"dual-5hz", "map-rate=5"},
+        {"dual-5hz-fec4", "map-rate=5 fec=4"},
+        {"budget-6k", "map-rate=1000 budget=6000"},
+    };
+    for (auto& m : mode_specs) {
+        SimMode mode;
+        mode.name = m[0];
+        istringstream in(m[1]);
+        parse_mode(in, mode);
+        modes.push_back(mode);
+    }
+    const char* link_specs[] = {
+        "name=clean",
+        "name=referee bw=6000 queue=16 latency=30 jitter=10",
+        "name=lossy bw=6000 queue=16 latency=30 jitter=20 loss=0.05 burst=3 reorder=0.02",
+        "name=congested bw=3000 queue=4 latency=30 jitter=10",
+    };
+    for (const char* spec : link_specs) {
+        LinkProfile p;
+        parse_link_profile(spec, p);
+        links.push_back(p);
+    }
+}
+
+// ============ 虚拟时钟仿真 ============
+static SimReport run_scenario(const vector<MqttPacket>& frames, double fps, const SimMode& mode,
+                              const LinkProfile& link, unsigned seed) {
+    SimReport rep;
+    DualRateSender sender(mode.sender);
+    LinkEmulator emu(link, seed);
+    FecDecoder fec;
+    // 虚拟时间从1秒开始，避免0被当作“无时间戳”
+    const int64_t t0 = 1000000;
+    const int64_t interval = (int64_t)(1e6 / fps);
+    const int64_t end = t0 + (int64_t)frames.size() * interval + SIM_DRAIN_US;
+
+    vector<OutPacket> out, delivered;
+    vector<bool> shown(frames.size(), false);
+    int64_t shown_map_capture = -1;
+    size_t next_frame = 0;
+
+    for (int64_t now = t0; now < end; now += SIM_TICK_US) {
+        int64_t capture_us = t0 + (int64_t)next_frame * interval;
+        if (next_frame < frames.size() && now >= capture_us) {
+            ProcessResult r;
+            r.packet = frames[next_frame];
+            r.meta.capture_us = capture_us;
+            packet_set_capture_ts(r.packet, capture_us);
+            sender.on_frame(r, now, out);
+            if (shown_map_capture >= 0) {
+                rep.map_age_sum_us += now - shown_map_capture;
+                rep.map_age_samples++;
+            }
+            next_frame++;
+        }
+        sender.poll(now, out);
+        for (const OutPacket& p : out) {
+            if (p.type == OutPacket::MAP) rep.map_sent++;
+            emu.push(p, now);
+        }
+        out.clear();
+
+        delivered.clear();
+        emu.poll(now, delivered);
+        for (const OutPacket& p : delivered) {
+            uint32_t ts;
+            if (p.type == OutPacket::MAP || p.type == OutPacket::PARITY) {
+                MqttPacket map;
+                if (p.type == OutPacket::MAP) {
+                    memcpy(&map, p.data, sizeof(map));
+                    fec.on_map(map);
+                } else {
+                    ParityPacket pp;
+                    memcpy(&pp, p.data, sizeof(pp));
+                    if (!fec.on_parity(pp, map)) continue;
+                    rep.fec_recovered++;
+                }
+                ts = packet_capture_ts(map);
+                rep.map_delivered++;
+                shown_map_capture = max(shown_map_capture, (int64_t)ts);
+            } else {
+                BallPacket bp;
+                memcpy(&bp, p.data, sizeof(bp));
+                ts = bp.capture_us;
+            }
+            rep.latency_us.push_back(now - (int64_t)ts);
+            // 帧间插值补发的弹丸包不对应任何采集帧，不计入完整度
+            int64_t rel = (int64_t)ts - t0;
+            if (rel >= 0 && rel % interval == 0 && rel / interval < (int64_t)frames.size()) {
+                shown[rel / interval] = true;
+            }
+        }
+    }
+    rep.frames = (long)frames.size();
+    rep.frames_shown = (long)count(shown.begin(), shown.end(), true);
+    rep.deferred_maps = sender.stats().deferred_maps;
+    rep.link = emu.stats();
+    return rep;
+}
+
+static void print_report_header() {
+    cout << left << setw(14) << "mode" << setw(12) << "link" << right << setw(8) << "frames"
+         << setw(10) << "map sent" << setw(11) << "map recv%" << setw(10) << "shown%"
+         << setw(26) << "latency p50/p99/max ms" << setw(12) << "map age ms"
+         << setw(10) << "deferred" << setw(9) << "fec rec" << setw(10) << "q.drops" << setw(8) << "lost" << endl;
+}
+
+static void print_report_row(const SimMode& mode, const LinkProfile& link, SimReport& rep) {
+    vector<int64_t>& lat = rep.latency_us;
+    sort(lat.begin(), lat.end());
+    ostringstream latency;
+    latency << fixed << setprecision(1);
+    if (lat.empty()) {
+        latency << "-";
+    } else {
+        latency << lat[lat.size() / 2] / 1000.0 << "/" << lat[(lat.size() - 1) * 99 / 100] / 1000.0
+                << "/" << lat.back() / 1000.0;
+    }
+    cout << left << setw(14) << mode.name << setw(12) << link.name << right << fixed
+         << setw(8) << rep.frames << setw(10) << rep.map_sent << setprecision(1)
+         << setw(11) << (rep.map_sent ? 100.0 * rep.map_delivered / rep.map_sent : 0.0)
+         << setw(10) << (rep.frames ? 100.0 * rep.frames_shown / rep.frames : 0.0)
+         << setw(26) << latency.str()
+         << setw(12) << (rep.map_age_samples ? rep.map_age_sum_us / rep.map_age_samples / 1000.0 : 0.0)
+         << setw(10) << rep.deferred_maps << setw(9) << rep.fec_recovered << setw(10) << rep.link.queue_drops
+         << setw(8) << rep.link.lost << endl;
+}
+
+static int run_sim(int argc, char* argv[]) {
+    string input, script;
+    double fps = 0;
+    unsigned seed = 1;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--script" && i + 1 < argc) script = argv[++i];
+        else if (arg == "--fps" && i + 1 < argc) fps = atof(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = (unsigned)atoi(argv[++i]);
+        else if (input.empty() && arg[0] != '-') input = arg;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (input.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    vector<SimMode> modes;
+    vector<LinkProfile> links;
+    if (script.empty()) {
+        default_scenarios(modes, links);
+    } else if (!load_script(script, modes, links)) {
+        return 1;
+    }
+    if (modes.empty() || links.empty()) {
+        cerr << "[错误] 场景脚本至少需要一个mode和一个link" << endl;
+        return 1;
+    }
+
+    vector<MqttPacket> frames;
+    if (!load_frames(input, fps, frames)) {
+        cerr << "Error: Could not load frames from " << input << endl;
+        return 1;
+    }
+    if (fps <= 0) fps = 30.0;
+    cout << "Input: " << input << ", " << frames.size() << " frames @ " << fps << " fps, seed " << seed << endl;
+
+    print_report_header();
+    for (const SimMode& m : modes) {
+        for (const LinkProfile& l : links) {
+            SimReport rep = run_scenario(frames, fps, m, l, seed);
+            print_report_row(m, l, rep);
+        }
+    }
+    return 0;
+}
+
+// ============ 实时UDP转发 ============
+static int run_relay(int argc, char* argv[]) {
+    int listen_port = -1;
+    string forward;
+    unsigned seed = 1;
+    LinkProfile profile;
+    profile.name = "relay";
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--listen" && i + 1 < argc) listen_port = atoi(argv[++i]);
+        else if (arg == "--forward" && i + 1 < argc) forward = argv[++i];
+        else if (arg == "--seed" && i + 1 < argc) seed = (unsigned)atoi(argv[++i]);
+        else if (!parse_link_param(arg, profile)) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (listen_port <= 0 || forward.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    UdpReceiver rx;
+    UdpSender tx;
+    if (!rx.open(listen_port) || !tx.open(forward)) return 1;
+    LinkEmulator emu(profile, seed);
+    signal(SIGINT, handle_sigint);
+    cout << "Relaying UDP :" << listen_port << " -> " << forward << endl;
+
+    vector<OutPacket> in, out;
+    auto last_log_time = high_resolution_clock::now();
+    while (g_running) {
+        // 有在途包时按其到达时刻收紧等待，保证转发时刻准确到1ms以内
+        int timeout_ms = 5;
+        int64_t next = emu.next_delivery_us();
+        if (next >= 0) timeout_ms = (int)min<int64_t>(timeout_ms, max<int64_t>(0, (next - monotonic_us()) / 1000));
+
+        in.clear();
+        if (rx.receive(in, timeout_ms) < 0) break;
+        int64_t now = monotonic_us();
+        for (const OutPacket& p : in) emu.push(p, now);
+        out.clear();
+        emu.poll(now, out);
+        if (!out.empty()) tx.send(out);
+
+        auto t = high_resolution_clock::now();
+        if (duration_cast<duration<double>>(t - last_log_time).count() >= 5.0) {
+            print_link_emu_stats(emu.stats(), emu.profile());
+            last_log_time = t;
+        }
+    }
+    print_link_emu_stats(emu.stats(), emu.profile());
+    return 0;
+}
+
+// ============ 主函数 ============
+int main(int argc, char* argv[]) {
+    string cmd = argc > 1 ? argv[1] : "";
+    if (cmd == "sim") return run_sim(argc, argv);
+    if (cmd == "relay") return run_relay(argc, argv);
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,300 @@
+#include "header.h"
+#include "packet_log.h"
+#include "thread.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+// ============ 微基准 ============
+// 自带的小型计时框架：每个用例先倍增迭代次数直到单批耗时不少于--min-time，
+// 再重复--repetitions批，报告每次操作耗时的中位数、最小值与批间离散度。
+// 覆盖 process()（多种输入分辨率）、compressRLE/decodeRLE（真实位图与人工最坏情况）和RingBuffer。
+
+struct BenchCase {
+    string name;
+    function<void()> run;   // 执行一次被测操作
+    double items;           // 每次操作处理的数量，用于换算吞吐
+    const char* unit;       // 吞吐单位（百万items每秒）
+};
+
+struct BenchOptions {
+    string filter;          // 只跑名称包含该子串的用例
+    double min_time_ms = 200;
+    int repetitions = 5;
+    int threads = 0;        // 大于0时额外跑一组弹丸分支并行的process()
+    string video;           // 取输入画面与真实位图的视频，为空时在vid/下查找
+    string bitmaps;         // .pkt/.hpl，从中解码真实位图；为空时用视频帧生成
+};
+
+static volatile uint64_t g_sink = 0;  // 累加结果，防止被测代码被优化掉
+
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog << " [--filter SUBSTR] [--min-time MS] [--repetitions N] [--threads N]"
+            " [--video FILE] [--bitmaps LOG(.pkt|.hpl)]" << endl;
+}
+
+// ============ 计时 ============
+static double time_batch(const BenchCase& c, long iters) {
+    auto t0 = steady_clock::now();
+    for (long i = 0; i < iters; i++) c.run();
+    return duration_cast<duration<double, nano>>(steady_clock::now() - t0).count();
+}
+
+static void run_case(const BenchCase& c, const BenchOptions& opt) {
+    c.run();  // 预热：首次调用分配缓冲区
+    long iters = 1;
+    double min_ns = opt.min_time_ms * 1e6;
+    while (true) {
+        double ns = time_batch(c, iters);
+        if (ns >= min_ns || iters >= (1L << 30)) break;
+        // 按已测速度估计所需次数，最多放大10倍以免首批过短估计失真
+        iters = (long)min((double)iters * 10, max((double)iters * 2, iters * min_ns / max(ns, 1.0) * 1.2));
+    }
+    vector<double> per_op;
+    for (int r = 0; r < opt.repetitions; r++) per_op.push_back(time_batch(c, iters) / iters);
+    sort(per_op.begin(), per_op.end());
+    double median = per_op[per_op.size() / 2];
+    double spread = median > 0 ? (per_op.back() - per_op.front()) / median * 100 : 0;
+
+    cout << left << setw(36) << c.name << right << setw(11) << iters
+         << fixed << setprecision(1) << setw(13) << median << setw(13) << per_op.front()
+         << setw(8) << spread << "%" << setw(11) << setprecision(2) << c.items / median * 1e3
+         << " " << c.unit << endl;
+}
+
+// ============ 输入数据 ============
+static string find_video(const BenchOptions& opt) {
+    if (!opt.video.empty()) return opt.video;
+    for (const char* dir : {"vid/", "../vid/", "../../vid/"}) {
+        string path = string(dir) + "test_video1.mp4";
+        if (ifstream(path)) return path;
+    }
+    return "";
+}
+
+// 找不到视频时的合成画面：暗色噪声背景上的场地线条与绿色弹丸
+static Mat synthetic_scene() {
+    Mat img(720, 1280, CV_8UC3);
+    randu(img, Scalar(20, 20, 20), Scalar(60, 60, 60));
+    for (int k = 0; k < 12; k++) {
+        line(img, Point(k * 107, 0), Point(1279 - k * 53, 719), Scalar(220, 220, 220), 3);
+    }
+    rectangle(img, Rect(200, 150, 880, 420), Scalar(230, 230, 230), 4);
+    for (int k = 0; k < 6; k++) {
+        circle(img, Point(300 + k * 130, 360 + (k % 2) * 90), 18, Scalar(60, 220, 60), -1);
+    }
+    return img;
+}
+
+static bool load_bitmaps(const string& path, vector<Mat>& out) {
+    vector<MqttPacket> packets;
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".pkt") == 0) {
+        ifstream in(path, ios::binary);
+        if (!in) return false;
+        MqttPacket pkt;
+        while (in.read(reinterpret_cast<char*>(&pkt), sizeof(pkt))) packets.push_back(pkt);
+    } else {
+        PacketLogReader log;
+        if (!log.open(path)) return false;
+        OutPacket p;
+        int64_t ts;
+        while (log.next(p, ts)) {
+            if (p.type != OutPacket::MAP || p.len != TOTAL_PACKET_BYTE) continue;
+            packets.push_back(MqttPacket());
+            memcpy(&packets.back(), p.data, sizeof(MqttPacket));
+        }
+    }
+    for (const MqttPacket& pkt : packets) {
+        int payload_len;
+        if (!packet_validate(pkt, payload_len)) continue;
+        Mat img;
+        decodePacketInto(pkt, payload_len, img);
+        out.push_back(img);
+    }
+    return true;
+}
+
+// 人工位图：棋盘格与单像素条纹让每个游程只有1像素，是RLE的最坏情况；全黑是最好情况
+static Mat pattern_bitmap(const string& kind) {
+    Mat img = Mat::zeros(TARGET_SIZE, CV_8UC1);
+    for (int y = 0; y < img.rows; y++) {
+        uchar* row = img.ptr<uchar>(y);
+        for (int x = 0; x < img.cols; x++) {
+            bool on = kind == "checkerboard" ? ((x + y) & 1) != 0
+                    : kind == "vstripes"     ? (x & 1) != 0
+                    : kind == "hstripes"     ? (y & 1) != 0
+                    : false;
+            row[x] = on ? 255 : 0;
+        }
+    }
+    return img;
+}
+
+// ============ 主函数 ============
+int main(int argc, char* argv[]) {
+    BenchOptions opt;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) opt.filter = argv[++i];
+        else if (arg == "--min-time" && i + 1 < argc) opt.min_time_ms = max(1.0, atof(argv[++i]));
+        else if (arg == "--repetitions" && i + 1 < argc) opt.repetitions = max(1, atoi(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc) opt.threads = max(0, atoi(argv[++i]));
+        else if (arg == "--video" && i + 1 < argc) opt.video = argv[++i];
+        else if (arg == "--bitmaps" && i + 1 < argc) opt.bitmaps = argv[++i];
+        else if (arg == "-h" || arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // 输入画面：视频的第一帧，没有视频时用合成画面
+    Mat scene;
+    vector<Mat> video_frames;
+    string video = find_video(opt);
+    if (!video.empty()) {
+        VideoCapture cap(video);
+        Mat f;
+        while (video_frames.size() < 64 && cap.read(f)) video_frames.push_back(f.clone());
+    }
+    if (!video_frames.empty()) {
+        scene = video_frames.front();
+        cout << "Input: " << video << " (" << scene.cols << "x" << scene.rows << ")" << endl;
+    } else {
+        scene = synthetic_scene();
+        cout << "Input: synthetic scene (no video found, use --video)" << endl;
+    }
+
+    // 真实位图：优先取包日志，否则用视频帧（或合成画面）过一遍压缩器
+    vector<Mat> real;
+    if (!opt.bitmaps.empty() && !load_bitmaps(opt.bitmaps, real)) {
+        cerr << "[错误] 无法读取: " << opt.bitmaps << endl;
+        return 1;
+    }
+    if (real.empty()) {
+        HeroCamCompressor c;
+        if (video_frames.empty()) video_frames.push_back(scene);
+        for (Mat& f : video_frames) real.push_back(c.process(f).finalBinary);
+    }
+    cout << "Real bitmaps: " << real.size() << (opt.bitmaps.empty() ? " (from input frames)" : " from " + opt.bitmaps)
+         << ", OpenCV " << CV_VERSION << ", " << getNumThreads() << " OpenCV threads" << endl;
+    video_frames.clear();
+
+    vector<BenchCase> cases;
+    const double pixels = TARGET_SIZE.area();
+
+    // process()：不同输入分辨率，每个分辨率独立的压缩器（中间缓冲区按尺寸复用）
+    unique_ptr<ThreadPool> pool;
+    if (opt.threads > 0) pool.reset(new ThreadPool(opt.threads));
+    const Size resolutions[] = {Size(320, 240), Size(640, 480), Size(1280, 720), Size(1920, 1080)};
+    for (const Size& sz : resolutions) {
+        auto input = make_shared<Mat>();
+        resize(scene, *input, sz, 0, 0, INTER_AREA);
+        string name = "process/" + to_string(sz.width) + "x" + to_string(sz.height);
+        for (int pooled = 0; pooled <= (pool ? 1 : 0); pooled++) {
+            auto c = make_shared<HeroCamCompressor>();
+            if (pooled) c->setThreadPool(pool.get());
+            cases.push_back({name + (pooled ? "/pool" + to_string(opt.threads) : ""),
+                             [c, input]() { g_sink += c->process(*input).rle_used_byte; },
+                             (double)sz.area(), "Mpix/s"});
+        }
+    }
+
+    // compressRLE / decodeRLE：真实位图轮流使用，人工位图固定一幅
+    struct BitmapSet {
+        string name;
+        vector<Mat> images;
+    };
+    vector<BitmapSet> sets = {{"real", real}};
+    for (const char* kind : {"checkerboard", "vstripes", "hstripes", "blank"}) {
+        sets.push_back({kind, {pattern_bitmap(kind)}});
+    }
+    auto plain = make_shared<HeroCamCompressor>();
+    auto sync8 = make_shared<HeroCamCompressor>();
+    sync8->setResyncRows(8);
+    const int uncapped = 2 * TARGET_SIZE.area() + 2 * TARGET_SIZE.height;  // 每像素一个游程也写得下
+
+    for (const BitmapSet& set : sets) {
+        auto images = make_shared<vector<Mat>>(set.images);
+        auto next = make_shared<size_t>(0);
+        auto buf = make_shared<vector<uint8_t>>(uncapped);
+        auto encode_case = [&](const string& suffix, shared_ptr<HeroCamCompressor> c, int max_len) {
+            cases.push_back({"compressRLE/" + set.name + suffix,
+                             [c, images, next, buf, max_len]() {
+                                 const Mat& img = (*images)[(*next)++ % images->size()];
+                                 g_sink += c->compressRLE(img, buf->data(), max_len);
+                             },
+                             pixels, "Mpix/s"});
+        };
+        encode_case("", plain, RLE_DATA_MAX_BYTE);
+        if (set.name == "real") encode_case("/sync8", sync8, RLE_DATA_MAX_BYTE);
+        if (set.name != "real" && set.name != "blank") encode_case("/uncapped", plain, uncapped);
+    }
+
+    for (const BitmapSet& set : sets) {
+        // 预先压缩好，解码用例只测解码本身；人工位图用不截断的完整编码
+        auto streams = make_shared<vector<vector<uint8_t>>>();
+        int max_len = set.name == "real" ? RLE_DATA_MAX_BYTE : uncapped;
+        for (const Mat& img : set.images) {
+            vector<uint8_t> rle(uncapped);
+            rle.resize(plain->compressRLE(img, rle.data(), max_len));
+            streams->push_back(rle);
+        }
+        auto next = make_shared<size_t>(0);
+        auto out = make_shared<Mat>();
+        cases.push_back({"decodeRLEInto/" + set.name,
+                         [streams, next, out]() {
+                             const vector<uint8_t>& rle = (*streams)[(*next)++ % streams->size()];
+                             decodeRLEInto(rle.data(), (int)rle.size(), TARGET_SIZE, *out);
+                             g_sink += out->data[0];
+                         },
+                         pixels, "Mpix/s"});
+        if (set.name == "real") {
+            cases.push_back({"decodeRLE/real (alloc)",
+                             [streams, next]() {
+                                 const vector<uint8_t>& rle = (*streams)[(*next)++ % streams->size()];
+                                 g_sink += decodeRLE(rle.data(), (int)rle.size(), TARGET_SIZE).data[0];
+                             },
+                             pixels, "Mpix/s"});
+        }
+    }
+
+    // RingBuffer：采集线程入队、调度线程出队的一次往返（Mat只拷贝头，引用计数加减）
+    auto ring = make_shared<RingBuffer>(4);
+    auto frame = make_shared<FrameEnvelope>();
+    frame->image = scene;
+    cases.push_back({"RingBuffer/push+pop",
+                     [ring, frame]() {
+                         FrameEnvelope in;
+                         in.image = frame->image;
+                         ring->push(std::move(in));
+                         ring->pop(*frame);
+                     },
+                     1, "Mop/s"});
+
+    cout << "\n" << left << setw(36) << "Benchmark" << right << setw(11) << "Iters"
+         << setw(13) << "Median ns" << setw(13) << "Min ns" << setw(9) << "Spread"
+         << setw(11) << "Throughput" << endl;
+    int run = 0;
+    for (const BenchCase& c : cases) {
+        if (!opt.filter.empty() && c.name.find(opt.filter) == string::npos) continue;
+        run_case(c, opt);
+        run++;
+    }
+    if (run == 0) {
+        cerr << "No benchmark matches --filter " << opt.filter << endl;
+        return 1;
+    }
+    return 0;
+}
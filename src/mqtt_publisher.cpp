@@ -0,0 +1,587 @@
+#include "mqtt_publisher.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+constexpr int64_t MQTT_CONNECT_TIMEOUT_US = 3000000;   // TCP连接+CONNACK超时
+constexpr int64_t MQTT_MIN_BACKOFF_US = 200000;        // 重连退避下限
+constexpr int64_t MQTT_MAX_BACKOFF_US = 5000000;       // 重连退避上限
+constexpr int MQTT_POLL_MS = 100;
+constexpr size_t MQTT_MAX_PACKET_BYTES = 65536;          // 本协议的报文（主题+最长的校验包）远小于此
+
+// ============ MQTT报文编码 ============
+static void put_remaining_length(vector<uint8_t>& out, size_t len) {
+    do {
+        uint8_t b = len % 128;
+        len /= 128;
+        if (len > 0) b |= 0x80;
+        out.push_back(b);
+    } while (len > 0);
+}
+
+static void put_string(vector<uint8_t>& out, const string& s) {
+    out.push_back((uint8_t)(s.size() >> 8));
+    out.push_back((uint8_t)(s.size() & 0xFF));
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+static void put_connect(vector<uint8_t>& out, const string& client_id, int keepalive_s) {
+    out.push_back(0x10);
+    put_remaining_length(out, 10 + 2 + client_id.size());
+    put_string(out, "MQTT");
+    out.push_back(4);      // 协议级别 3.1.1
+    out.push_back(0x02);   // clean session
+    out.push_back((uint8_t)(keepalive_s >> 8));
+    out.push_back((uint8_t)(keepalive_s & 0xFF));
+    put_string(out, client_id);
+}
+
+static void put_publish(vector<uint8_t>& out, const string& topic, const uint8_t* data, int len) {
+    out.push_back(0x30);   // PUBLISH, QoS0, 不保留
+    put_remaining_length(out, 2 + topic.size() + len);
+    put_string(out, topic);
+    out.insert(out.end(), data, data + len);
+}
+
+static void put_subscribe(vector<uint8_t>& out, uint16_t packet_id, const vector<string>& filters) {
+    size_t len = 2;
+    for (const string& f : filters) len += 2 + f.size() + 1;
+    out.push_back(0x82);   // SUBSCRIBE，固定头低4位必须为0010
+    put_remaining_length(out, len);
+    out.push_back((uint8_t)(packet_id >> 8));
+    out.push_back((uint8_t)(packet_id & 0xFF));
+    for (const string& f : filters) {
+        put_string(out, f);
+        out.push_back(0);  // 请求QoS0
+    }
+}
+
+// 从缓冲区头部解析一个完整报文的固定头；报文不完整时返回false，格式错误时把 malformed 置true。
+// 剩余长度超过MQTT_MAX_PACKET_BYTES也按格式错误处理，不为声明的超长报文无限缓存
+static bool parse_fixed_header(const vector<uint8_t>& in, size_t& header_len, size_t& body_len,
+                               bool& malformed) {
+    malformed = false;
+    body_len = 0;
+    int shift = 0;
+    for (size_t pos = 1; pos < in.size(); pos++) {
+        if (pos > 4) {
+            malformed = true;
+            return false;
+        }
+        body_len |= (size_t)(in[pos] & 0x7F) << shift;
+        shift += 7;
+        if (!(in[pos] & 0x80)) {
+            header_len = pos + 1;
+            if (body_len > MQTT_MAX_PACKET_BYTES) {
+                malformed = true;
+                return false;
+            }
+            return in.size() >= header_len + body_len;
+        }
+    }
+    return false;
+}
+
+bool parse_broker(const string& spec, MqttConfig& cfg) {
+    size_t colon = spec.rfind(':');
+    string host = colon == string::npos ? spec : spec.substr(0, colon);
+    if (host.empty()) return false;
+    if (colon != string::npos) {
+        int port = atoi(spec.c_str() + colon + 1);
+        if (port <= 0 || port > 65535) return false;
+        cfg.port = port;
+    }
+    cfg.host = host;
+    return true;
+}
+
+// ============ MqttPublisher 成员函数实现 ============
+MqttPublisher::MqttPublisher(const MqttConfig& cfg) : cfg_(cfg) {
+    cfg_.queue_depth = max(1, cfg_.queue_depth);
+    cfg_.keepalive_s = max(1, cfg_.keepalive_s);
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        topic_map_[i] = cfg_.topic + "/" + to_string(i) + "/map";
+        topic_ball_[i] = cfg_.topic + "/" + to_string(i) + "/ball";
+        topic_fec_[i] = cfg_.topic + "/" + to_string(i) + "/fec";
+    }
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    thread_ = thread(&MqttPublisher::io_loop, this);
+}
+
+MqttPublisher::~MqttPublisher() {
+    stop_ = true;
+    wake();
+    if (thread_.joinable()) thread_.join();
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+}
+
+void MqttPublisher::publish(const OutPacket& pkt) {
+    {
+        lock_guard<mutex> lock(mutex_);
+        if ((int)queue_.size() >= cfg_.queue_depth) {
+            // 新数据比旧数据更有价值：丢最旧的，永不阻塞调用方
+            queue_.pop_front();
+            stats_.dropped++;
+        }
+        Pending p;
+        p.pkt = pkt;
+        p.enqueue_us = monotonic_us();
+        queue_.push_back(p);
+    }
+    wake();
+}
+
+MqttStats MqttPublisher::stats() const {
+    lock_guard<mutex> lock(mutex_);
+    return stats_;
+}
+
+void MqttPublisher::reset_stats() {
+    lock_guard<mutex> lock(mutex_);
+    bool connected = stats_.connected;
+    stats_ = MqttStats();
+    stats_.connected = connected;
+}
+
+void MqttPublisher::wake() {
+    if (wake_fd_ < 0) return;
+    uint64_t one = 1;
+    ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+    (void)n;
+}
+
+bool MqttPublisher::start_connect() {
+    int64_t now = monotonic_us();
+    addrinfo hints, *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    string port = to_string(cfg_.port);
+    if (getaddrinfo(cfg_.host.c_str(), port.c_str(), &hints, &res) != 0 || !res) {
+        state_since_us_ = now;
+        close_socket("cannot resolve broker");
+        return false;
+    }
+
+    fd_ = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        freeaddrinfo(res);
+        close_socket(strerror(errno));
+        return false;
+    }
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // 小包立即发出，不等Nagle合并
+
+    int rc = connect(fd_, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (rc != 0 && errno != EINPROGRESS) {
+        close_socket(strerror(errno));
+        return false;
+    }
+    state_ = CONNECTING;
+    state_since_us_ = now;
+    return true;
+}
+
+void MqttPublisher::close_socket(const char* reason) {
+    bool was_connected = state_ == CONNECTED;
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    state_ = DISCONNECTED;
+    {
+        lock_guard<mutex> lock(mutex_);
+        // 写了一半的包随连接一起作废
+        stats_.dropped += (long)out_marks_.size();
+        stats_.connected = false;
+    }
+    out_.clear();
+    out_off_ = 0;
+    out_marks_.clear();
+    in_.clear();
+    ping_outstanding_ = false;
+
+    if (was_connected || !warned_) {
+        cerr << "[MQTT] " << cfg_.host << ":" << cfg_.port << " "
+             << (was_connected ? "disconnected" : "connect failed") << ": " << reason
+             << ", retrying in background" << endl;
+        warned_ = true;
+    }
+    backoff_us_ = was_connected ? MQTT_MIN_BACKOFF_US
+                                : min(MQTT_MAX_BACKOFF_US, max(MQTT_MIN_BACKOFF_US, backoff_us_ * 2));
+    retry_at_us_ = monotonic_us() + backoff_us_;
+}
+
+// 把队列中全部待发包编码进输出缓冲区；只在上一批完全写出后调用，已交给内核的数据不再受队列上限约束
+void MqttPublisher::fill_output() {
+    deque<Pending> batch;
+    {
+        lock_guard<mutex> lock(mutex_);
+        batch.swap(queue_);
+    }
+    if (batch.empty()) return;
+    out_.clear();
+    out_off_ = 0;
+    for (auto& p : batch) {
+        int sid = min(max(p.pkt.stream_id, 0), MAX_STREAMS - 1);
+        const string& topic = p.pkt.type == OutPacket::MAP    ? topic_map_[sid]
+                              : p.pkt.type == OutPacket::BALL ? topic_ball_[sid]
+                                                              : topic_fec_[sid];
+        put_publish(out_, topic, p.pkt.data, p.pkt.len);
+        out_marks_.push_back(make_pair(out_.size(), p.enqueue_us));
+    }
+}
+
+bool MqttPublisher::flush_output() {
+    while (out_off_ < out_.size()) {
+        ssize_t n = send(fd_, out_.data() + out_off_, out_.size() - out_off_, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno == EINTR) continue;
+            return false;
+        }
+        out_off_ += n;
+        int64_t now = monotonic_us();
+
+        lock_guard<mutex> lock(mutex_);
+        stats_.bytes += n;
+        while (!out_marks_.empty() && out_marks_.front().first <= out_off_) {
+            stats_.published++;
+            stats_.latency_us.push_back(now - out_marks_.front().second);
+            out_marks_.pop_front();
+        }
+    }
+    if (out_off_ == out_.size()) {
+        out_.clear();
+        out_off_ = 0;
+    }
+    return true;
+}
+
+bool MqttPublisher::read_input() {
+    uint8_t buf[256];
+    while (true) {
+        ssize_t n = recv(fd_, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n == 0) return false;
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno == EINTR) continue;
+            return false;
+        }
+        in_.insert(in_.end(), buf, buf + n);
+        last_recv_us_ = monotonic_us();
+    }
+
+    // 逐个解析完整报文；发布者只关心CONNACK和PINGRESP
+    size_t pos, len;
+    bool malformed;
+    while (parse_fixed_header(in_, pos, len, malformed)) {
+        uint8_t type = in_[0] & 0xF0;
+        if (type == 0xD0) {
+            ping_outstanding_ = false;
+        } else if (type == 0x20) {
+            if (len < 2 || in_[pos + 1] != 0) {
+                close_socket("broker refused connection");
+                return true;
+            }
+            state_ = CONNECTED;
+            backoff_us_ = 0;
+            if (warned_) {
+                cout << "[MQTT] connected to " << cfg_.host << ":" << cfg_.port << endl;
+            }
+            warned_ = false;
+            lock_guard<mutex> lock(mutex_);
+            if (ever_connected_) stats_.reconnects++;
+            ever_connected_ = true;
+            stats_.connected = true;
+        }
+        in_.erase(in_.begin(), in_.begin() + pos + len);
+    }
+    return !malformed;
+}
+
+void MqttPublisher::io_loop() {
+    while (!stop_) {
+        int64_t now = monotonic_us();
+        if (state_ == DISCONNECTED && now >= retry_at_us_) start_connect();
+
+        if ((state_ == CONNECTING || state_ == WAIT_CONNACK) &&
+            now - state_since_us_ > MQTT_CONNECT_TIMEOUT_US) {
+            close_socket("timeout");
+        } else if (state_ == CONNECTED) {
+            int64_t keepalive_us = cfg_.keepalive_s * 1000000L;
+            if (now - last_recv_us_ > keepalive_us * 3 / 2) {
+                close_socket("keepalive timeout");
+            } else {
+                if (out_.empty()) fill_output();
+                // QoS0发布没有应答，持续发送时last_recv_us_只靠PINGRESP刷新，
+                // 所以心跳按接收方向计时，与是否有数据在发无关；PINGREQ追加在待写数据之后
+                if (!ping_outstanding_ && now - last_recv_us_ >= keepalive_us / 2) {
+                    out_.push_back(0xC0);  // PINGREQ
+                    out_.push_back(0x00);
+                    ping_outstanding_ = true;
+                }
+            }
+        }
+
+        pollfd fds[2];
+        fds[0].fd = wake_fd_;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        int nfds = 1;
+        if (fd_ >= 0) {
+            fds[1].fd = fd_;
+            fds[1].events = POLLIN;
+            fds[1].revents = 0;
+            if (state_ == CONNECTING || out_off_ < out_.size()) fds[1].events |= POLLOUT;
+            nfds = 2;
+        }
+        int timeout_ms = MQTT_POLL_MS;
+        if (state_ == DISCONNECTED) {
+            timeout_ms = (int)min<int64_t>(MQTT_POLL_MS, max<int64_t>(0, (retry_at_us_ - now) / 1000));
+        }
+        if (poll(fds, nfds, timeout_ms) < 0 && errno != EINTR) break;
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t v;
+            ssize_t n = ::read(wake_fd_, &v, sizeof(v));
+            (void)n;
+        }
+        if (nfds < 2 || fd_ < 0) continue;
+
+        short rev = fds[1].revents;
+        now = monotonic_us();
+        if (state_ == CONNECTING) {
+            if (!(rev & (POLLOUT | POLLERR | POLLHUP))) continue;
+            int err = 0;
+            socklen_t elen = sizeof(err);
+            getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &elen);
+            if (err != 0) {
+                close_socket(strerror(err));
+                continue;
+            }
+            put_connect(out_, cfg_.client_id, cfg_.keepalive_s);
+            state_ = WAIT_CONNACK;
+            state_since_us_ = now;
+            last_recv_us_ = now;
+        }
+        if ((rev & (POLLIN | POLLERR | POLLHUP)) && !read_input()) {
+            close_socket("connection closed by broker");
+            continue;
+        }
+        if (fd_ >= 0 && out_off_ < out_.size() && !flush_output()) {
+            close_socket(strerror(errno));
+        }
+    }
+
+    // 退出前尽力发送DISCONNECT，让broker立即释放会话
+    if (fd_ >= 0) {
+        if (state_ == CONNECTED) {
+            uint8_t disconnect[2] = {0xE0, 0x00};
+            ssize_t n = send(fd_, disconnect, sizeof(disconnect), MSG_NOSIGNAL | MSG_DONTWAIT);
+            (void)n;
+        }
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+// ============ MqttSubscriber 成员函数实现 ============
+MqttSubscriber::MqttSubscriber(const MqttConfig& cfg) : cfg_(cfg) {
+    cfg_.keepalive_s = max(1, cfg_.keepalive_s);
+}
+
+MqttSubscriber::~MqttSubscriber() {
+    if (fd_ >= 0) {
+        uint8_t disconnect[2] = {0xE0, 0x00};
+        ssize_t n = send(fd_, disconnect, sizeof(disconnect), MSG_NOSIGNAL | MSG_DONTWAIT);
+        (void)n;
+        ::close(fd_);
+    }
+}
+
+bool MqttSubscriber::send_all(const vector<uint8_t>& buf) {
+    size_t off = 0;
+    while (off < buf.size()) {
+        ssize_t n = send(fd_, buf.data() + off, buf.size() - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        off += n;
+    }
+    last_send_us_ = monotonic_us();
+    return true;
+}
+
+// 阻塞连接（带超时），连上后立即发送CONNECT与SUBSCRIBE；CONNACK/SUBACK在receive()中处理
+bool MqttSubscriber::connect_broker() {
+    addrinfo hints, *res = nullptr;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    string port = to_string(cfg_.port);
+    if (getaddrinfo(cfg_.host.c_str(), port.c_str(), &hints, &res) != 0 || !res) {
+        disconnect("cannot resolve broker");
+        return false;
+    }
+    fd_ = socket(res->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        freeaddrinfo(res);
+        disconnect(strerror(errno));
+        return false;
+    }
+    int rc = connect(fd_, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    if (rc != 0 && errno != EINPROGRESS) {
+        disconnect(strerror(errno));
+        return false;
+    }
+    pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    int err = 0;
+    socklen_t elen = sizeof(err);
+    if (poll(&pfd, 1, (int)(MQTT_CONNECT_TIMEOUT_US / 1000)) <= 0 ||
+        getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &elen) != 0 || err != 0) {
+        disconnect(err ? strerror(err) : "timeout");
+        return false;
+    }
+
+    vector<uint8_t> out;
+    put_connect(out, cfg_.client_id, cfg_.keepalive_s);
+    vector<string> filters;
+    filters.push_back(cfg_.topic + "/+/map");
+    filters.push_back(cfg_.topic + "/+/ball");
+    filters.push_back(cfg_.topic + "/+/fec");
+    put_subscribe(out, 1, filters);
+    if (!send_all(out)) {
+        disconnect(strerror(errno));
+        return false;
+    }
+    last_recv_us_ = monotonic_us();
+    in_.clear();
+    cout << "[MQTT] subscribed to " << cfg_.topic << "/+/{map,ball,fec} at "
+         << cfg_.host << ":" << cfg_.port << endl;
+    warned_ = false;
+    return true;
+}
+
+void MqttSubscriber::disconnect(const char* reason) {
+    bool was_connected = fd_ >= 0;
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+    if (was_connected || !warned_) {
+        cerr << "[MQTT] " << cfg_.host << ":" << cfg_.port << " "
+             << (was_connected ? "disconnected" : "connect failed") << ": " << reason << endl;
+        warned_ = true;
+    }
+    retry_at_us_ = monotonic_us() + MQTT_MAX_BACKOFF_US / 5;
+}
+
+int MqttSubscriber::receive(vector<OutPacket>& out, int timeout_ms) {
+    int64_t now = monotonic_us();
+    if (fd_ < 0) {
+        if (now < retry_at_us_ || !connect_broker()) {
+            poll(nullptr, 0, timeout_ms);
+            return 0;
+        }
+    }
+
+    int64_t keepalive_us = cfg_.keepalive_s * 1000000L;
+    if (now - last_recv_us_ > keepalive_us * 3 / 2) {
+        disconnect("keepalive timeout");
+        return 0;
+    }
+    if (now - last_send_us_ >= keepalive_us / 2) {
+        vector<uint8_t> ping;
+        ping.push_back(0xC0);
+        ping.push_back(0x00);
+        if (!send_all(ping)) {
+            disconnect(strerror(errno));
+            return 0;
+        }
+    }
+
+    pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, timeout_ms) <= 0) return 0;
+
+    uint8_t buf[4096];
+    while (true) {
+        ssize_t n = recv(fd_, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n == 0) {
+            disconnect("connection closed by broker");
+            return 0;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno == EINTR) continue;
+            disconnect(strerror(errno));
+            return 0;
+        }
+        in_.insert(in_.end(), buf, buf + n);
+        last_recv_us_ = monotonic_us();
+        // 一次最多缓存一个最长报文，其余留在socket中等下次receive()
+        if (in_.size() >= MQTT_MAX_PACKET_BYTES) break;
+    }
+
+    int count = 0;
+    size_t pos, len;
+    bool malformed;
+    OutPacket pkt;
+    while (parse_fixed_header(in_, pos, len, malformed)) {
+        uint8_t type = in_[0] & 0xF0;
+        if (type == 0x20 && len >= 2 && in_[pos + 1] != 0) {
+            disconnect("broker refused connection");
+            return count;
+        }
+        if (type == 0x30 && len >= 2) {
+            // PUBLISH：主题长度 + 主题 + （QoS>0时的报文ID）+ 负载
+            size_t topic_len = ((size_t)in_[pos] << 8) | in_[pos + 1];
+            size_t payload = pos + 2 + topic_len + (((in_[0] >> 1) & 0x03) ? 2 : 0);
+            if (payload <= pos + len &&
+                classify_packet(in_.data() + payload, (int)(pos + len - payload), pkt)) {
+                out.push_back(pkt);
+                count++;
+            }
+        }
+        in_.erase(in_.begin(), in_.begin() + pos + len);
+    }
+    if (malformed) disconnect("malformed packet");
+    return count;
+}
+
+// ============ 统计输出 ============
+void print_mqtt_stats(const MqttStats& stats, double elapsed_sec) {
+    if (elapsed_sec <= 0) return;
+    cout << "MQTT: " << (stats.connected ? "connected" : "disconnected")
+         << ", published " << stats.published << " (" << fixed << setprecision(1)
+         << stats.published / elapsed_sec << " pkt/s, " << setprecision(0)
+         << stats.bytes / elapsed_sec << " B/s), dropped " << stats.dropped
+         << ", reconnects " << stats.reconnects;
+    if (!stats.latency_us.empty()) {
+        vector<int64_t> lat = stats.latency_us;
+        sort(lat.begin(), lat.end());
+        int64_t sum = 0;
+        for (int64_t v : lat) sum += v;
+        cout << ", publish latency avg " << setprecision(2) << sum / 1000.0 / lat.size()
+             << " / p99 " << lat[(lat.size() - 1) * 99 / 100] / 1000.0
+             << " / max " << lat.back() / 1000.0 << " ms";
+    }
+    cout << endl;
+}
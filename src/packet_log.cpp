@@ -0,0 +1,225 @@
+#include "packet_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+static size_t record_size(int len) { return sizeof(PacketLogRecord) + align8(len); }
+
+// ============ PacketLogWriter 成员函数实现 ============
+PacketLogWriter::~PacketLogWriter() { close(); }
+
+bool PacketLogWriter::open(const string& path, size_t prealloc_bytes) {
+    close();
+    path_ = path;
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        cerr << "[错误] 无法创建包日志: " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    capacity_ = max(prealloc_bytes, (size_t)4096);
+    // 预先分配磁盘块，写入时不会因为缺页扩展文件而卡顿；文件系统不支持时退回ftruncate
+    if (posix_fallocate(fd_, 0, capacity_) != 0 && ftruncate(fd_, capacity_) != 0) {
+        cerr << "[错误] 包日志预分配失败: " << strerror(errno) << endl;
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    void* p = mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) {
+        cerr << "[错误] 包日志mmap失败: " << strerror(errno) << endl;
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+    base_ = static_cast<uint8_t*>(p);
+
+    PacketLogHeader* hdr = reinterpret_cast<PacketLogHeader*>(base_);
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = PACKET_LOG_MAGIC;
+    hdr->version = PACKET_LOG_VERSION;
+    hdr->data_end = sizeof(PacketLogHeader);
+    index_.clear();
+    return true;
+}
+
+bool PacketLogWriter::grow(size_t need) {
+    size_t cap = capacity_;
+    while (cap < need) cap *= 2;
+    if (posix_fallocate(fd_, 0, cap) != 0 && ftruncate(fd_, cap) != 0) return false;
+    void* p = mremap(base_, capacity_, cap, MREMAP_MAYMOVE);
+    if (p == MAP_FAILED) return false;
+    base_ = static_cast<uint8_t*>(p);
+    capacity_ = cap;
+    return true;
+}
+
+bool PacketLogWriter::append(const OutPacket& pkt, int64_t timestamp_us) {
+    if (!base_) return false;
+    PacketLogHeader* hdr = reinterpret_cast<PacketLogHeader*>(base_);
+    uint64_t off = hdr->data_end;
+    size_t rec_bytes = record_size(pkt.len);
+    if (off + rec_bytes > capacity_) {
+        if (!grow(off + rec_bytes)) {
+            cerr << "[错误] 包日志扩展失败，停止记录: " << strerror(errno) << endl;
+            close();
+            return false;
+        }
+        hdr = reinterpret_cast<PacketLogHeader*>(base_);
+    }
+
+    PacketLogRecord* rec = reinterpret_cast<PacketLogRecord*>(base_ + off);
+    rec->timestamp_us = timestamp_us;
+    rec->stream_id = (uint8_t)pkt.stream_id;
+    rec->type = (uint8_t)pkt.type;
+    rec->length = (uint16_t)pkt.len;
+    rec->reserved = 0;
+    memcpy(base_ + off + sizeof(PacketLogRecord), pkt.data, pkt.len);
+
+    if (hdr->record_count == 0) hdr->start_us = timestamp_us;
+    if (hdr->record_count % PACKET_LOG_INDEX_STRIDE == 0) {
+        PacketLogIndexEntry e;
+        e.timestamp_us = timestamp_us;
+        e.offset = off;
+        index_.push_back(e);
+    }
+    hdr->record_count++;
+    hdr->data_end = off + rec_bytes;
+    return true;
+}
+
+void PacketLogWriter::close() {
+    if (!base_) return;
+    PacketLogHeader* hdr = reinterpret_cast<PacketLogHeader*>(base_);
+    size_t index_bytes = index_.size() * sizeof(PacketLogIndexEntry);
+    size_t final_size = hdr->data_end;
+    if (hdr->data_end + index_bytes <= capacity_ || grow(hdr->data_end + index_bytes)) {
+        hdr = reinterpret_cast<PacketLogHeader*>(base_);
+        if (index_bytes) memcpy(base_ + hdr->data_end, index_.data(), index_bytes);
+        hdr->index_offset = hdr->data_end;
+        hdr->index_count = index_.size();
+        final_size = hdr->data_end + index_bytes;
+    }
+    munmap(base_, capacity_);
+    base_ = nullptr;
+    // 去掉预分配的空余部分
+    if (ftruncate(fd_, final_size) != 0) {
+        cerr << "[警告] 包日志截断失败: " << strerror(errno) << endl;
+    }
+    ::close(fd_);
+    fd_ = -1;
+    capacity_ = 0;
+    index_.clear();
+}
+
+uint64_t PacketLogWriter::records() const {
+    return base_ ? reinterpret_cast<const PacketLogHeader*>(base_)->record_count : 0;
+}
+
+uint64_t PacketLogWriter::bytes() const {
+    return base_ ? reinterpret_cast<const PacketLogHeader*>(base_)->data_end : 0;
+}
+
+// ============ PacketLogReader 成员函数实现 ============
+PacketLogReader::~PacketLogReader() { close(); }
+
+bool PacketLogReader::open(const string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PacketLogHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return false;
+    base_ = static_cast<const uint8_t*>(p);
+    size_ = st.st_size;
+    header_ = reinterpret_cast<const PacketLogHeader*>(base_);
+    if (header_->magic != PACKET_LOG_MAGIC || header_->version != PACKET_LOG_VERSION ||
+        header_->data_end > size_) {
+        close();
+        return false;
+    }
+    data_end_ = header_->data_end;
+
+    if (header_->index_offset &&
+        header_->index_offset + header_->index_count * sizeof(PacketLogIndexEntry) <= size_) {
+        const PacketLogIndexEntry* idx =
+            reinterpret_cast<const PacketLogIndexEntry*>(base_ + header_->index_offset);
+        index_.assign(idx, idx + header_->index_count);
+    } else {
+        // 写端未正常关闭：顺序扫描重建索引
+        cerr << "[包日志] " << path << " 缺少索引（写端未正常关闭），扫描重建" << endl;
+        uint64_t off = sizeof(PacketLogHeader);
+        for (uint64_t n = 0; off + sizeof(PacketLogRecord) <= data_end_; n++) {
+            const PacketLogRecord* rec = reinterpret_cast<const PacketLogRecord*>(base_ + off);
+            if (n % PACKET_LOG_INDEX_STRIDE == 0) {
+                PacketLogIndexEntry e;
+                e.timestamp_us = rec->timestamp_us;
+                e.offset = off;
+                index_.push_back(e);
+            }
+            off += record_size(rec->length);
+        }
+    }
+
+    // 最后一条记录的时间戳：从最后一个索引项向后扫
+    last_us_ = header_->start_us;
+    uint64_t off = index_.empty() ? data_end_ : index_.back().offset;
+    while (off + sizeof(PacketLogRecord) <= data_end_) {
+        const PacketLogRecord* rec = reinterpret_cast<const PacketLogRecord*>(base_ + off);
+        last_us_ = rec->timestamp_us;
+        off += record_size(rec->length);
+    }
+    rewind();
+    return true;
+}
+
+void PacketLogReader::close() {
+    if (base_) munmap(const_cast<uint8_t*>(base_), size_);
+    base_ = nullptr;
+    header_ = nullptr;
+    size_ = 0;
+    data_end_ = 0;
+    index_.clear();
+}
+
+void PacketLogReader::rewind() { pos_ = sizeof(PacketLogHeader); }
+
+bool PacketLogReader::next(OutPacket& pkt, int64_t& timestamp_us) {
+    if (!base_ || pos_ + sizeof(PacketLogRecord) > data_end_) return false;
+    const PacketLogRecord* rec = reinterpret_cast<const PacketLogRecord*>(base_ + pos_);
+    if (rec->length > sizeof(pkt.data) || pos_ + record_size(rec->length) > data_end_) return false;
+    timestamp_us = rec->timestamp_us;
+    pkt.type = rec->type <= OutPacket::PARITY ? (OutPacket::Type)rec->type : OutPacket::MAP;
+    pkt.stream_id = rec->stream_id;
+    pkt.len = rec->length;
+    memcpy(pkt.data, base_ + pos_ + sizeof(PacketLogRecord), rec->length);
+    pos_ += record_size(rec->length);
+    return true;
+}
+
+void PacketLogReader::seek(int64_t timestamp_us) {
+    rewind();
+    if (!base_) return;
+    // 索引按时间有序：找最后一个不晚于目标时刻的索引项，再向后顺序扫描
+    auto it = upper_bound(index_.begin(), index_.end(), timestamp_us,
+                          [](int64_t t, const PacketLogIndexEntry& e) { return t < e.timestamp_us; });
+    if (it != index_.begin()) pos_ = (it - 1)->offset;
+    while (pos_ + sizeof(PacketLogRecord) <= data_end_) {
+        const PacketLogRecord* rec = reinterpret_cast<const PacketLogRecord*>(base_ + pos_);
+        if (rec->timestamp_us >= timestamp_us) break;
+        pos_ += record_size(rec->length);
+    }
+}
@@ -0,0 +1,526 @@
+#include "header.h"
+#include "mqtt_publisher.h"
+#include "udp_transport.h"
+#include "packet_log.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <unistd.h>
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+// ============ 操作手端接收程序 ============
+// 从MQTT、UDP或包日志接收数据包，解码后按窗口实际尺寸渲染。
+// 解码与渲染的中间缓冲区按流复用，稳态下每帧不分配内存。
+const Size DEFAULT_VIEW_SIZE(960, 640);   // 窗口尺寸不可查询或无界面时的渲染尺寸
+constexpr int64_t MAX_BALL_EXTRAPOLATE_US = 150000;   // 弹丸外推上限，数据中断时不会一直推出去
+constexpr int64_t CLOCK_WINDOW_US = 10000000;         // 时钟偏差估计的半窗口
+constexpr int64_t ANIMATE_INTERVAL_US = 16000;        // 无新数据时淡入/外推动画的重绘间隔
+constexpr int BALL_MATCH_DIST = 12;                   // 地图包弹丸沿用已有速度的最大匹配距离（小分辨率像素）
+
+static atomic<bool> g_running{true};
+
+static void handle_sigint(int) { g_running = false; }
+
+struct ReceiverOptions {
+    string mqtt_broker;          // host[:port]
+    string topic = "hero";
+    int udp_port = -1;
+    string log_path;             // hero_cam --log-packets 记录的 .hpl 包日志，或 hero_batch 输出的 .pkt 文件
+    double log_fps = 30.0;       // .pkt 回放速率，0表示不限速
+    bool display = true;
+    bool extrapolate = true;     // 按速度把弹丸外推到显示时刻
+    int fade_ms = 120;           // 新地图淡入时长，0表示直接切换
+    int link_latency_ms = 0;     // 链路最小单向时延（无法从时间戳测出，需给定）
+};
+
+// ============ 发送端时钟偏差估计 ============
+// 数据包带发送端monotonic_us低32位。取近期 (接收时刻 - 包内时间戳) 的最小值，
+// 即“时钟偏差 + 最小单向时延”；两个半窗口轮换，跟随时钟漂移。
+class ClockOffset {
+public:
+    void on_sample(uint32_t ts, int64_t recv_us) {
+        int32_t d = (int32_t)((uint32_t)recv_us - ts);
+        if (!valid_ || recv_us - window_start_us_ >= CLOCK_WINDOW_US) {
+            prev_min_ = valid_ ? cur_min_ : d;
+            cur_min_ = d;
+            window_start_us_ = recv_us;
+            valid_ = true;
+        } else {
+            cur_min_ = min(cur_min_, d);
+        }
+    }
+    bool valid() const { return valid_; }
+    int32_t delta_us() const { return min(prev_min_, cur_min_); }
+    // 时间戳ts对应的时刻到now_us经过了多久（本机时钟）
+    int64_t age_us(uint32_t ts, int64_t now_us, int64_t link_latency_us) const {
+        return (int32_t)((uint32_t)now_us - ts) - delta_us() + link_latency_us;
+    }
+
+private:
+    bool valid_ = false;
+    int32_t cur_min_ = 0;
+    int32_t prev_min_ = 0;
+    int64_t window_start_us_ = 0;
+};
+
+// ============ 每路视频流的显示状态 ============
+struct StreamView {
+    bool active = false;
+    string window;
+    MqttPacket map;
+    int map_len = 0;                 // 地图包有效载荷字节数
+    bool has_map = false;
+    bool map_dirty = false;          // 收到新地图包，需要重新解码
+    MqttPacket damaged;              // 校验失败但带同步标记的地图包，解码其中完好的分段
+    bool damaged_dirty = false;
+    FecDecoder fec;
+    bool dirty = false;              // 需要重新渲染
+    int64_t pending_recv_us = 0;     // 待显示数据中最早的接收时刻
+    uint32_t pending_capture_ts = 0; // 待显示数据的采集时间戳（同机时用于采集到显示时延）
+
+    // 当前显示的弹丸：位置取自最新的弹丸包或地图包，速度取自弹丸包（地图包不带速度，按最近邻沿用）
+    struct BallTrack {
+        float x, y, r;
+        float vx, vy;                // 小分辨率像素/秒
+    };
+    BallTrack tracks[4];
+    int track_count = 0;
+    uint32_t tracks_ts = 0;          // 弹丸位置对应的发送端时刻
+
+    Mat small;                       // 120x80 解码结果
+    Mat small_bgr;
+    Mat prev_bgr;                    // 淡入过程中的上一张地图
+    Mat blend;
+    int64_t fade_start_us = 0;
+    Mat canvas;                      // 窗口尺寸的渲染结果
+    int64_t last_render_us = 0;
+
+    long rendered = 0;
+    long partial = 0;                // 部分解码的受损地图包
+    long partial_rows = 0;
+    vector<int64_t> display_latency_us;   // 接收到显示
+    vector<int64_t> capture_latency_us;   // 采集到显示
+};
+
+// 用新观测替换弹丸轨迹；比当前轨迹旧（乱序到达）的观测不覆盖
+static void update_tracks(StreamView& v, const BallInfo* balls, const BallVelocity* vel, uint32_t ts) {
+    if (v.tracks_ts != 0 && (int32_t)(ts - v.tracks_ts) < 0) return;
+    StreamView::BallTrack next[4];
+    int n = 0;
+    for (int i = 0; i < 4; i++) {
+        if (balls[i].x == 0 && balls[i].y == 0) continue;
+        StreamView::BallTrack t;
+        t.x = balls[i].x;
+        t.y = balls[i].y;
+        t.r = balls[i].r;
+        t.vx = t.vy = 0;
+        if (vel) {
+            t.vx = (float)vel[i].vx * BALL_VEL_UNIT;
+            t.vy = (float)vel[i].vy * BALL_VEL_UNIT;
+        } else {
+            int best_d = BALL_MATCH_DIST * BALL_MATCH_DIST + 1;
+            for (int j = 0; j < v.track_count; j++) {
+                float dx = t.x - v.tracks[j].x, dy = t.y - v.tracks[j].y;
+                if (dx * dx + dy * dy < best_d) {
+                    best_d = (int)(dx * dx + dy * dy);
+                    t.vx = v.tracks[j].vx;
+                    t.vy = v.tracks[j].vy;
+                }
+            }
+        }
+        next[n++] = t;
+    }
+    memcpy(v.tracks, next, sizeof(next));
+    v.track_count = n;
+    v.tracks_ts = ts;
+}
+
+static void on_packet(StreamView& v, const OutPacket& pkt, int payload_len, int64_t recv_us) {
+    uint32_t ts;
+    if (pkt.type == OutPacket::MAP) {
+        memcpy(&v.map, pkt.data, sizeof(MqttPacket));
+        v.map_len = payload_len;
+        v.has_map = true;
+        v.map_dirty = true;
+        ts = packet_capture_ts(v.map);
+        update_tracks(v, v.map.balls, nullptr, ts);
+    } else {
+        BallPacket bp;
+        memcpy(&bp, pkt.data, sizeof(BallPacket));
+        ts = bp.capture_us;
+        update_tracks(v, bp.balls, bp.vel, ts);
+    }
+    if (!v.dirty) v.pending_recv_us = recv_us;
+    v.pending_capture_ts = ts;
+    v.dirty = true;
+}
+
+// 弹丸在运动或地图正在淡入时，没有新数据也要继续重绘
+static bool animating(const StreamView& v, const ReceiverOptions& opt, const ClockOffset& clock, int64_t now_us) {
+    if (now_us - v.last_render_us < ANIMATE_INTERVAL_US) return false;
+    if (opt.fade_ms > 0 && now_us - v.fade_start_us < opt.fade_ms * 1000L) return true;
+    if (!opt.extrapolate || !clock.valid() || v.tracks_ts == 0) return false;
+    bool moving = false;
+    for (int i = 0; i < v.track_count; i++) moving |= v.tracks[i].vx != 0 || v.tracks[i].vy != 0;
+    return moving && clock.age_us(v.tracks_ts, now_us, opt.link_latency_ms * 1000L) < MAX_BALL_EXTRAPOLATE_US;
+}
+
+static void render_view(StreamView& v, Size view_size, const ReceiverOptions& opt, const ClockOffset& clock,
+                        int64_t now_us) {
+    bool decoded = false;
+    bool had_map = !v.small_bgr.empty();
+    if (v.map_dirty) {
+        decodePacketInto(v.map, v.map_len, v.small);
+        v.map_dirty = false;
+        decoded = true;
+    }
+    if (v.damaged_dirty) {
+        // 只覆盖受损包中完好的分段，其余行保留上一张地图
+        int rows = decodeDamagedInto(v.damaged, v.small);
+        if (rows > 0) {
+            v.partial++;
+            v.partial_rows += rows;
+            decoded = true;
+        }
+        v.damaged_dirty = false;
+    }
+    if (decoded) {
+        if (opt.fade_ms > 0 && had_map) {
+            v.small_bgr.copyTo(v.prev_bgr);
+            v.fade_start_us = now_us;
+        }
+        // 先在小图上转彩色，再一次最近邻放大到窗口尺寸，放大后的大图只遍历一遍
+        cvtColor(v.small, v.small_bgr, COLOR_GRAY2BGR);
+    }
+
+    // 新地图在fade_ms内从上一张线性过渡过来，在小图上混合
+    const Mat* map_img = &v.small_bgr;
+    int64_t fade_us = opt.fade_ms * 1000L;
+    if (fade_us > 0 && !v.prev_bgr.empty() && now_us - v.fade_start_us < fade_us) {
+        double alpha = (double)(now_us - v.fade_start_us) / fade_us;
+        addWeighted(v.small_bgr, alpha, v.prev_bgr, 1.0 - alpha, 0, v.blend);
+        map_img = &v.blend;
+    }
+    resize(*map_img, v.canvas, view_size, 0, 0, INTER_NEAREST);
+
+    // 弹丸按速度外推到此刻：采集时刻经时钟偏差换算到本机时钟
+    double age_s = 0;
+    if (opt.extrapolate && clock.valid() && v.tracks_ts != 0) {
+        int64_t age = clock.age_us(v.tracks_ts, now_us, opt.link_latency_ms * 1000L);
+        age_s = min(max(age, (int64_t)0), MAX_BALL_EXTRAPOLATE_US) / 1e6;
+    }
+    double sx = (double)view_size.width / TARGET_SIZE.width;
+    double sy = (double)view_size.height / TARGET_SIZE.height;
+    for (int i = 0; i < v.track_count; i++) {
+        const StreamView::BallTrack& t = v.tracks[i];
+        double x = min(max(t.x + t.vx * age_s, 0.0), (double)TARGET_SIZE.width - 1);
+        double y = min(max(t.y + t.vy * age_s, 0.0), (double)TARGET_SIZE.height - 1);
+        int real_radius = max(1, cvRound(t.r * sx));
+        Point center(cvRound(x * sx), cvRound(y * sy));
+        circle(v.canvas, center, real_radius, Scalar(255, 255, 255), -1);
+        circle(v.canvas, center, real_radius + 3, Scalar(0, 255, 0), 3);
+    }
+    v.last_render_us = now_us;
+}
+
+static void print_display_stats(StreamView& v, double elapsed_sec, const string& label) {
+    if (v.display_latency_us.empty()) return;
+    vector<int64_t>& lat = v.display_latency_us;
+    sort(lat.begin(), lat.end());
+    int64_t sum = 0;
+    for (int64_t x : lat) sum += x;
+    cout << "[" << label << "] rendered " << v.rendered << " (" << fixed << setprecision(1)
+         << v.rendered / elapsed_sec << " fps), receive-to-display avg " << setprecision(2)
+         << sum / 1000.0 / lat.size() << " / p99 " << lat[(lat.size() - 1) * 99 / 100] / 1000.0
+         << " / max " << lat.back() / 1000.0 << " ms";
+    if (!v.capture_latency_us.empty()) {
+        vector<int64_t>& cap = v.capture_latency_us;
+        sort(cap.begin(), cap.end());
+        cout << ", capture-to-display p50 " << cap[cap.size() / 2] / 1000.0
+             << " / p99 " << cap[(cap.size() - 1) * 99 / 100] / 1000.0 << " ms";
+    }
+    cout << endl;
+    v.rendered = 0;
+    v.display_latency_us.clear();
+    v.capture_latency_us.clear();
+}
+
+// ============ 包日志回放 ============
+// .hpl 包日志按记录的发出时刻回放；hero_batch 的 .pkt 文件没有时间戳，按固定帧率回放
+class PacketReplay {
+public:
+    bool open(const string& path, double fps) {
+        next_us_ = monotonic_us();
+        raw_ = path.size() > 4 && path.compare(path.size() - 4, 4, ".pkt") == 0;
+        if (raw_) {
+            raw_in_.open(path, ios::binary);
+            interval_us_ = fps > 0 ? (int64_t)(1e6 / fps) : 0;
+            return raw_in_.is_open();
+        }
+        if (!log_.open(path)) return false;
+        cout << "Packet log: " << log_.records() << " packets, "
+             << (log_.end_us() - log_.start_us()) / 1e6 << " s" << endl;
+        have_pending_ = log_.next(pending_, pending_ts_);
+        base_ts_ = pending_ts_;
+        return true;
+    }
+    // 读出已到回放时刻的包，回放结束返回-1
+    int receive(vector<OutPacket>& out, int timeout_ms) {
+        int64_t now = monotonic_us();
+        if (raw_) {
+            if (now < next_us_) {
+                this_thread::sleep_for(microseconds(min<int64_t>(next_us_ - now, timeout_ms * 1000L)));
+                return 0;
+            }
+            uint8_t buf[TOTAL_PACKET_BYTE];
+            OutPacket pkt;
+            if (!raw_in_.read(reinterpret_cast<char*>(buf), sizeof(buf))) return -1;
+            next_us_ += interval_us_;
+            if (!classify_packet(buf, sizeof(buf), pkt)) return 0;
+            out.push_back(pkt);
+            return 1;
+        }
+        if (!have_pending_) return -1;
+        int64_t due = next_us_ + (pending_ts_ - base_ts_);
+        if (now < due) {
+            this_thread::sleep_for(microseconds(min<int64_t>(due - now, timeout_ms * 1000L)));
+            return 0;
+        }
+        // 同一时刻发出的包一起交付
+        int count = 0;
+        while (have_pending_ && next_us_ + (pending_ts_ - base_ts_) <= now) {
+            out.push_back(pending_);
+            count++;
+            have_pending_ = log_.next(pending_, pending_ts_);
+        }
+        return count;
+    }
+
+private:
+    bool raw_ = false;
+    ifstream raw_in_;
+    int64_t interval_us_ = 0;
+    int64_t next_us_ = 0;
+    PacketLogReader log_;
+    OutPacket pending_;
+    int64_t pending_ts_ = 0;
+    int64_t base_ts_ = 0;
+    bool have_pending_ = false;
+};
+
+static void print_usage(const char* prog) {
+    cerr << "Usage: " << prog
+         << " (--mqtt HOST[:PORT] [--topic PREFIX] | --udp PORT | --log FILE.hpl | --log FILE.pkt [--fps F])"
+            " [--headless] [--no-extrapolate] [--fade MS] [--link-latency MS]" << endl;
+}
+
+static void print_receiver_stats(StreamView* views, LinkMonitor& monitor, const ClockOffset& clock,
+                                 double elapsed_sec) {
+    cout << "\n===== RECEIVER STATISTICS =====" << endl;
+    if (clock.valid()) {
+        cout << "Clock: receiver - sender (incl. min one-way delay) " << fixed << setprecision(2)
+             << clock.delta_us() / 1000.0 << " ms" << endl;
+    }
+    for (int i = 0; i < MAX_STREAMS; i++) {
+        if (!views[i].active) continue;
+        string label = "Stream " + to_string(i);
+        print_link_stats(monitor.stats(i), elapsed_sec, label);
+        print_display_stats(views[i], elapsed_sec, label);
+        StreamView& v = views[i];
+        const FecStats& fs = v.fec.stats();
+        if (fs.parity_received || v.partial) {
+            cout << "[" << label << "] parity " << fs.parity_received << ", recovered " << fs.recovered
+                 << ", unrecoverable groups " << fs.unrecoverable << ", partial decodes " << v.partial
+                 << " (" << v.partial_rows << " rows)" << endl;
+        }
+        v.fec.reset_stats();
+        v.partial = 0;
+        v.partial_rows = 0;
+    }
+    monitor.reset_stats();
+}
+
+// ============ 主函数 ============
+int main(int argc, char* argv[]) {
+    ReceiverOptions opt;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--mqtt" && i + 1 < argc) {
+            opt.mqtt_broker = argv[++i];
+        } else if (arg == "--topic" && i + 1 < argc) {
+            opt.topic = argv[++i];
+        } else if (arg == "--udp" && i + 1 < argc) {
+            opt.udp_port = atoi(argv[++i]);
+        } else if (arg == "--log" && i + 1 < argc) {
+            opt.log_path = argv[++i];
+        } else if (arg == "--fps" && i + 1 < argc) {
+            opt.log_fps = atof(argv[++i]);
+        } else if (arg == "--headless") {
+            opt.display = false;
+        } else if (arg == "--no-extrapolate") {
+            opt.extrapolate = false;
+        } else if (arg == "--fade" && i + 1 < argc) {
+            opt.fade_ms = max(0, atoi(argv[++i]));
+        } else if (arg == "--link-latency" && i + 1 < argc) {
+            opt.link_latency_ms = max(0, atoi(argv[++i]));
+        } else {
+            cerr << "Unknown option: " << arg << endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    int sources = !opt.mqtt_broker.empty() + (opt.udp_port > 0) + !opt.log_path.empty();
+    if (sources != 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    unique_ptr<MqttSubscriber> mqtt;
+    unique_ptr<UdpReceiver> udp;
+    unique_ptr<PacketReplay> pkt_log;
+    if (!opt.mqtt_broker.empty()) {
+        MqttConfig mc;
+        if (!parse_broker(opt.mqtt_broker, mc)) {
+            cerr << "Invalid broker address: " << opt.mqtt_broker << endl;
+            return 1;
+        }
+        mc.topic = opt.topic;
+        mc.client_id = "hero_receiver_" + to_string(getpid());  // 与发布端client_id不同，否则broker会踢掉一方
+        mqtt.reset(new MqttSubscriber(mc));
+    } else if (opt.udp_port > 0) {
+        udp.reset(new UdpReceiver());
+        if (!udp->open(opt.udp_port)) return 1;
+        cout << "Listening on UDP port " << opt.udp_port << endl;
+    } else {
+        pkt_log.reset(new PacketReplay());
+        if (!pkt_log->open(opt.log_path, opt.log_fps)) {
+            cerr << "Error: Could not open packet log: " << opt.log_path << endl;
+            return 1;
+        }
+    }
+    signal(SIGINT, handle_sigint);
+
+    vector<StreamView> views(MAX_STREAMS);
+    LinkMonitor monitor;
+    ClockOffset clock;
+    long corrupt = 0;                // 校验失败的地图包（带同步标记的仍部分解码）
+    vector<OutPacket> packets;
+    packets.reserve(UDP_BATCH);
+    auto last_log_time = high_resolution_clock::now();
+
+    while (g_running) {
+        // 1. 接收：最多等5ms，保证窗口事件及时处理
+        packets.clear();
+        int n = mqtt ? mqtt->receive(packets, 5) : udp ? udp->receive(packets, 5) : pkt_log->receive(packets, 5);
+        if (n < 0 && pkt_log) break;  // 包日志回放结束
+
+        int64_t recv_us = monotonic_us();
+        for (const OutPacket& p : packets) {
+            const MqttPacket& mp = *reinterpret_cast<const MqttPacket*>(p.data);
+            int payload_len = 0;
+            bool damaged = false;
+            if (p.type == OutPacket::MAP && !packet_validate(mp, payload_len)) {
+                corrupt++;
+                damaged = mp.reserved[RESERVED_VERSION_OFFSET] == PACKET_VERSION &&
+                          mp.reserved[RESERVED_CODEC_OFFSET] == CODEC_RLE_SYNC;
+                if (!damaged) continue;
+            }
+            int sid = min(max(p.stream_id, 0), MAX_STREAMS - 1);
+            StreamView& v = views[sid];
+            // 损坏包的流编号取自未通过校验的包头，不能据此新建视图
+            if (damaged && !v.active) continue;
+            if (!v.active) {
+                v.active = true;
+                v.window = "Operator #" + to_string(sid);
+                if (opt.display) {
+                    namedWindow(v.window, WINDOW_NORMAL);
+                    resizeWindow(v.window, DEFAULT_VIEW_SIZE.width, DEFAULT_VIEW_SIZE.height);
+                }
+            }
+            if (damaged) {
+                // 包头字段不可信，不参与链路统计；可能的话等校验包恢复完整版本
+                if (v.has_map) {
+                    v.damaged = mp;
+                    v.damaged_dirty = true;
+                    if (!v.dirty) v.pending_recv_us = recv_us;
+                    v.dirty = true;
+                }
+                continue;
+            }
+            monitor.on_packet(p, recv_us);
+            if (p.type == OutPacket::PARITY) {
+                ParityPacket pp;
+                MqttPacket rec;
+                memcpy(&pp, p.data, sizeof(pp));
+                // 恢复出的包比正在显示的地图新时才显示（校验包在组末发出，通常恢复的就是最近几帧）
+                if (v.fec.on_parity(pp, rec) && (!v.has_map || (int8_t)(rec.frame_seq - v.map.frame_seq) > 0)) {
+                    OutPacket op;
+                    classify_packet(reinterpret_cast<const uint8_t*>(&rec), sizeof(rec), op);
+                    on_packet(v, op, packet_payload_len(rec), recv_us);
+                }
+                continue;
+            }
+            if (p.type == OutPacket::MAP) v.fec.on_map(mp);
+            uint32_t ts = p.type == OutPacket::MAP ? packet_capture_ts(mp)
+                                                   : reinterpret_cast<const BallPacket*>(p.data)->capture_us;
+            if (ts != 0) clock.on_sample(ts, recv_us);
+            on_packet(v, p, payload_len, recv_us);
+        }
+
+        // 2. 渲染：重绘有新数据或正在做淡入/外推动画的流，按窗口当前实际尺寸渲染，避免再被窗口系统缩放一次
+        bool shown = false;
+        int64_t render_us = monotonic_us();
+        for (StreamView& v : views) {
+            if (!v.has_map || !(v.dirty || animating(v, opt, clock, render_us))) continue;
+            Size view_size = DEFAULT_VIEW_SIZE;
+            if (opt.display) {
+                Rect r = getWindowImageRect(v.window);
+                if (r.width > 0 && r.height > 0) view_size = r.size();
+            }
+            render_view(v, view_size, opt, clock, render_us);
+            if (opt.display) imshow(v.window, v.canvas);
+            shown = true;
+        }
+        if (opt.display) {
+            int key = waitKey(1);
+            if (key == 27 || key == 'q' || key == 'Q') break;
+        }
+        if (shown) {
+            int64_t display_us = monotonic_us();
+            for (StreamView& v : views) {
+                if (!v.dirty || !v.has_map) continue;
+                v.display_latency_us.push_back(display_us - v.pending_recv_us);
+                if (v.pending_capture_ts) {
+                    v.capture_latency_us.push_back((int32_t)((uint32_t)display_us - v.pending_capture_ts));
+                }
+                v.rendered++;
+                v.dirty = false;
+            }
+        }
+
+        // 3. 每5秒输出链路与显示统计
+        auto now = high_resolution_clock::now();
+        double elapsed = duration_cast<duration<double>>(now - last_log_time).count();
+        if (elapsed >= 5.0) {
+            print_receiver_stats(views.data(), monitor, clock, elapsed);
+            if (udp && udp->invalid() > 0) cout << "Invalid datagrams: " << udp->invalid() << endl;
+            if (corrupt > 0) cout << "Corrupt map packets: " << corrupt << endl;
+            last_log_time = now;
+        }
+    }
+
+    double elapsed = duration_cast<duration<double>>(high_resolution_clock::now() - last_log_time).count();
+    print_receiver_stats(views.data(), monitor, clock, elapsed);
+    if (opt.display) destroyAllWindows();
+    return 0;
+}
@@ -0,0 +1,339 @@
+#include "header.h"
+#include "mqtt_publisher.h"
+#include "packet_log.h"
+#include "udp_transport.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+// ============ 包日志回放工具 ============
+// play：按日志记录的发出时刻把包重新送进UDP或MQTT，用比赛实录复测接收端；
+// decode：把日志中的地图包全部读入内存后不限速解码，统计解码吞吐，并用逐帧哈希校验解码结果。
+
+static atomic<bool> g_running{true};
+
+static void handle_sigint(int) { g_running = false; }
+
+static void usage(const char* prog) {
+    cerr << "Usage:\n"
+         << "  " << prog << " play LOG.hpl (--udp HOST:PORT | --mqtt HOST[:PORT] [--topic T])"
+         << " [--speed X] [--from SEC] [--loop]\n"
+         << "  " << prog << " decode LOG(.hpl|.pkt) [--repeat N] [--hashes OUT.txt] [--verify REF.txt]" << endl;
+}
+
+static bool has_suffix(const string& s, const string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// ============ 按原始时序回放 ============
+static int run_play(int argc, char* argv[]) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    string path = argv[2];
+    string udp_target, mqtt_broker, mqtt_topic = "hero";
+    double speed = 1.0;
+    double from_s = 0.0;
+    bool loop = false;
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--udp" && i + 1 < argc) udp_target = argv[++i];
+        else if (arg == "--mqtt" && i + 1 < argc) mqtt_broker = argv[++i];
+        else if (arg == "--topic" && i + 1 < argc) mqtt_topic = argv[++i];
+        else if (arg == "--speed" && i + 1 < argc) speed = atof(argv[++i]);
+        else if (arg == "--from" && i + 1 < argc) from_s = atof(argv[++i]);
+        else if (arg == "--loop") loop = true;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (udp_target.empty() == mqtt_broker.empty() || speed <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    PacketLogReader log;
+    if (!log.open(path)) {
+        cerr << "[错误] 无法打开包日志: " << path << endl;
+        return 1;
+    }
+    cout << "Packet log: " << log.records() << " packets, "
+         << (log.end_us() - log.start_us()) / 1e6 << " s" << endl;
+
+    UdpSender udp;
+    unique_ptr<MqttPublisher> mqtt;
+    if (!udp_target.empty()) {
+        if (!udp.open(udp_target)) return 1;
+    } else {
+        MqttConfig mcfg;
+        if (!parse_broker(mqtt_broker, mcfg)) {
+            cerr << "[错误] 无效的MQTT地址: " << mqtt_broker << endl;
+            return 1;
+        }
+        mcfg.topic = mqtt_topic;
+        mcfg.client_id = "hero_replay";
+        mqtt.reset(new MqttPublisher(mcfg));
+    }
+    signal(SIGINT, handle_sigint);
+
+    int64_t seek_us = log.start_us() + (int64_t)(from_s * 1e6);
+    long sent = 0;
+    int64_t max_late_us = 0;
+    int64_t start_us = monotonic_us();
+    vector<OutPacket> batch;
+    do {
+        log.seek(seek_us);
+        OutPacket pkt;
+        int64_t ts;
+        bool have = log.next(pkt, ts);
+        if (!have) {
+            // seek越过最后一条记录时每轮都读不到包，--loop下会空转
+            cerr << "[错误] --from " << from_s << " s 之后没有数据包（日志时长 "
+                 << (log.end_us() - log.start_us()) / 1e6 << " s）" << endl;
+            return 1;
+        }
+        int64_t log_t0 = ts;
+        int64_t wall_t0 = monotonic_us();
+        while (have && g_running) {
+            // 日志时间按speed缩放后映射到本机时钟
+            int64_t due = wall_t0 + (int64_t)((ts - log_t0) / speed);
+            int64_t now = monotonic_us();
+            if (due > now) this_thread::sleep_for(microseconds(due - now));
+            max_late_us = max(max_late_us, monotonic_us() - due);
+
+            // 同一时刻发出的包合成一批，UDP走一次sendmmsg
+            batch.clear();
+            int64_t batch_ts = ts;
+            while (have && ts == batch_ts) {
+                batch.push_back(pkt);
+                have = log.next(pkt, ts);
+            }
+            if (mqtt) {
+                for (const OutPacket& p : batch) mqtt->publish(p);
+            } else {
+                udp.send(batch);
+            }
+            sent += batch.size();
+        }
+    } while (loop && g_running);
+
+    double elapsed = (monotonic_us() - start_us) / 1e6;
+    cout << "Replayed " << sent << " packets, max scheduling lag "
+         << fixed << setprecision(2) << max_late_us / 1000.0 << " ms" << endl;
+    if (mqtt) {
+        // 留出时间让后台线程把队列发完
+        this_thread::sleep_for(milliseconds(200));
+        print_mqtt_stats(mqtt->stats(), elapsed);
+    } else {
+        print_udp_send_stats(udp.stats(), elapsed);
+    }
+    return 0;
+}
+
+// ============ 解码基准 ============
+struct MapFrame {
+    int stream_id;
+    uint8_t frame_seq;
+    int payload_len;
+    MqttPacket packet;
+};
+
+// 校验失败的包不参与解码，计入rejected
+static bool load_map_frames(const string& path, vector<MapFrame>& frames, long& rejected) {
+    MapFrame f;
+    if (has_suffix(path, ".pkt")) {
+        ifstream in(path, ios::binary);
+        if (!in) return false;
+        while (in.read(reinterpret_cast<char*>(&f.packet), sizeof(f.packet))) {
+            if (!packet_validate(f.packet, f.payload_len)) {
+                rejected++;
+                continue;
+            }
+            f.stream_id = (f.packet.config & CFG_STREAM_MASK) >> CFG_STREAM_SHIFT;
+            f.frame_seq = f.packet.frame_seq;
+            frames.push_back(f);
+        }
+        return true;
+    }
+    PacketLogReader log;
+    if (!log.open(path)) return false;
+    OutPacket pkt;
+    int64_t ts;
+    while (log.next(pkt, ts)) {
+        if (pkt.type != OutPacket::MAP || pkt.len != TOTAL_PACKET_BYTE) continue;
+        memcpy(&f.packet, pkt.data, sizeof(f.packet));
+        if (!packet_validate(f.packet, f.payload_len)) {
+            rejected++;
+            continue;
+        }
+        f.stream_id = pkt.stream_id;
+        f.frame_seq = f.packet.frame_seq;
+        frames.push_back(f);
+    }
+    return true;
+}
+
+// FNV-1a 64位，对解码后的位图逐字节哈希
+static uint64_t hash_bitmap(const Mat& img) {
+    uint64_t h = 1469598103934665603ULL;
+    for (int y = 0; y < img.rows; y++) {
+        const uchar* row = img.ptr<uchar>(y);
+        for (int x = 0; x < img.cols; x++) {
+            h ^= row[x];
+            h *= 1099511628211ULL;
+        }
+    }
+    return h;
+}
+
+static bool write_hashes(const string& path, const vector<MapFrame>& frames, const vector<uint64_t>& hashes) {
+    ofstream out(path);
+    if (!out) return false;
+    out << "# hero_replay decode hashes: index stream frame_seq fnv1a64" << endl;
+    for (size_t i = 0; i < frames.size(); i++) {
+        out << i << " " << frames[i].stream_id << " " << (int)frames[i].frame_seq << " "
+            << hex << setw(16) << setfill('0') << hashes[i] << dec << setfill(' ') << "\n";
+    }
+    return (bool)out;
+}
+
+// 与参考哈希逐帧比对，返回不一致的帧数；参考文件帧数不同也算不一致
+static long verify_hashes(const string& path, const vector<uint64_t>& hashes) {
+    ifstream in(path);
+    if (!in) {
+        cerr << "[错误] 无法读取参考哈希: " << path << endl;
+        return -1;
+    }
+    long mismatches = 0;
+    size_t count = 0;
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        istringstream ls(line);
+        size_t idx;
+        int sid, seq;
+        string hex_hash;
+        if (!(ls >> idx >> sid >> seq >> hex_hash)) continue;
+        count++;
+        uint64_t ref = strtoull(hex_hash.c_str(), nullptr, 16);
+        if (idx >= hashes.size() || hashes[idx] != ref) {
+            if (mismatches < 10) {
+                cerr << "[校验] 第" << idx << "帧（流" << sid << " seq " << seq << "）哈希不一致" << endl;
+            }
+            mismatches++;
+        }
+    }
+    if (count != hashes.size()) {
+        cerr << "[校验] 参考文件 " << count << " 帧，本次解码 " << hashes.size() << " 帧" << endl;
+        mismatches += count > hashes.size() ? count - hashes.size() : hashes.size() - count;
+    }
+    return mismatches;
+}
+
+static int run_decode(int argc, char* argv[]) {
+    if (argc < 3) {
+        usage(argv[0]);
+        return 1;
+    }
+    string path = argv[2];
+    int repeat = 20;
+    string hashes_out, verify_ref;
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc) repeat = max(1, atoi(argv[++i]));
+        else if (arg == "--hashes" && i + 1 < argc) hashes_out = argv[++i];
+        else if (arg == "--verify" && i + 1 < argc) verify_ref = argv[++i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    vector<MapFrame> frames;
+    long rejected = 0;
+    if (!load_map_frames(path, frames, rejected)) {
+        cerr << "[错误] 无法读取: " << path << endl;
+        return 1;
+    }
+    if (frames.empty()) {
+        cerr << "[错误] " << path << " 中没有地图包" << endl;
+        return 1;
+    }
+    long payload_bytes = 0;
+    for (const MapFrame& f : frames) payload_bytes += f.payload_len;
+    cout << "Loaded " << frames.size() << " map packets from " << path << ", "
+         << payload_bytes / (double)frames.size() << " payload bytes avg";
+    if (rejected) cout << ", " << rejected << " rejected by header check";
+    cout << endl;
+
+    // 校验遍：逐帧哈希（不计时）
+    Mat decoded;
+    vector<uint64_t> hashes(frames.size());
+    for (size_t i = 0; i < frames.size(); i++) {
+        decodePacketInto(frames[i].packet, frames[i].payload_len, decoded);
+        hashes[i] = hash_bitmap(decoded);
+    }
+
+    // 计时遍：数据已全部在内存中，只测解码本身；取最快一遍作为吞吐，排除调度干扰
+    double best_s = 1e30, total_s = 0;
+    volatile uint64_t sink = 0;  // 防止编译器把解码优化掉
+    for (int r = 0; r < repeat; r++) {
+        auto t0 = steady_clock::now();
+        for (const MapFrame& f : frames) {
+            decodePacketInto(f.packet, f.payload_len, decoded);
+            sink += decoded.data[0];
+        }
+        double s = duration_cast<duration<double>>(steady_clock::now() - t0).count();
+        best_s = min(best_s, s);
+        total_s += s;
+    }
+
+    double n = (double)frames.size();
+    double pixels = n * TARGET_SIZE.area();
+    cout << fixed << setprecision(2)
+         << "Decode: " << repeat << " passes, best " << best_s * 1000 << " ms, mean "
+         << total_s / repeat * 1000 << " ms per pass" << endl
+         << "  " << n / best_s << " frames/s, " << best_s / n * 1e6 << " us/frame, "
+         << pixels / best_s / 1e6 << " Mpixel/s, " << payload_bytes / best_s / 1e6
+         << " MB/s RLE in" << endl;
+
+    if (!hashes_out.empty()) {
+        if (!write_hashes(hashes_out, frames, hashes)) {
+            cerr << "[错误] 无法写入哈希文件: " << hashes_out << endl;
+            return 1;
+        }
+        cout << "Hashes written to " << hashes_out << endl;
+    }
+    if (!verify_ref.empty()) {
+        long bad = verify_hashes(verify_ref, hashes);
+        if (bad != 0) {
+            cerr << "Verify FAILED: " << bad << " mismatching frames" << endl;
+            return 2;
+        }
+        cout << "Verify OK: " << hashes.size() << " frames match " << verify_ref << endl;
+    }
+    return 0;
+}
+
+// ============ 主函数 ============
+int main(int argc, char* argv[]) {
+    string cmd = argc > 1 ? argv[1] : "";
+    if (cmd == "play") return run_play(argc, argv);
+    if (cmd == "decode") return run_decode(argc, argv);
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,26 @@
+#include "thread.h"
+
+// ============ RingBuffer 成员函数实现 ============
+RingBuffer::RingBuffer(int capacity)
+    : capacity_(capacity), size_(0), head_(0), tail_(0), buffer_(capacity) {}
+
+bool RingBuffer::push(FrameEnvelope&& frame) {
+    if (size_ >= capacity_) return false;
+    buffer_[tail_] = std::move(frame);
+    tail_ = (tail_ + 1) % capacity_;
+    size_++;
+    return true;
+}
+
+bool RingBuffer::pop(FrameEnvelope& frame) {
+    if (size_ == 0) return false;
+    frame = std::move(buffer_[head_]);
+    head_ = (head_ + 1) % capacity_;
+    size_--;
+    return true;
+}
+
+int RingBuffer::size() const { return size_; }
+int RingBuffer::capacity() const { return capacity_; }
+bool RingBuffer::empty() const { return size_ == 0; }
+bool RingBuffer::full() const { return size_ >= capacity_; }
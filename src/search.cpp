@@ -1,614 +1,760 @@
 #include "thread.h"
+#include "thread_pool.h"
+#include "shm_frame.h"
+#include "mqtt_publisher.h"
+#include "udp_transport.h"
+#include "packet_log.h"
+#include "tracer.h"
 #include <iostream>
 #include <iomanip>
 #include <numeric>
 #include <algorithm>  // for max_element
 #include <chrono>
 #include <thread>
+#include <cstdlib>
+#include <unistd.h>
 
 using namespace cv;
 using namespace std;
 using namespace std::chrono;
 
 // ============ 全局变量定义 ============
-RingBuffer frame_queue(100);
-std::mutex camera_mutex;
+std::mutex pipeline_mutex;
 std::condition_variable frame_available;
-std::condition_variable queue_not_full;
 std::atomic<bool> running{true};
 int frame_skip = 1;
 
-// ============ HeroCamCompressor 成员函数实现 ============
-ProcessResult HeroCamCompressor::process(Mat& input) {
-    ProcessResult result;
-    if (input.empty()) return result;
-    int origW = input.cols;
-    int origH = input.rows;
-
-    // 1. Canny赛场轮廓提取
-    Mat gray, blurred, edges;
-    cvtColor(input, gray, COLOR_BGR2GRAY);
-    GaussianBlur(gray, blurred, Size(5, 5), 1.3);
-    Canny(blurred, edges, 50, 150);
-    
-    vector<vector<Point>> contours;
-    findContours(edges.clone(), contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-    
-    Mat visualization = Mat::zeros(input.size(), CV_8UC1);
-    drawContours(visualization, contours, -1, Scalar(255), 2);
-
-    Mat kernel1 = getStructuringElement(MORPH_RECT, Size(2,2));
-    Mat kernel2 = getStructuringElement(MORPH_RECT, Size(4,4));
-    erode(visualization, visualization, kernel1);
-    dilate(visualization, visualization, kernel2);
-
-    // 2. HSV绿色弹丸提取
-    Mat hsv, greenMask;
-    cvtColor(input, hsv, COLOR_BGR2HSV);
-    inRange(hsv, BALL_HSV_LOW, BALL_HSV_HIGH, greenMask);
-    morphologyEx(greenMask, greenMask, MORPH_CLOSE, kernel1);
-    dilate(greenMask, greenMask, kernel2);
-
-    vector<vector<Point>> ballContours;
-    findContours(greenMask.clone(), ballContours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-
-    // 按面积从大到小排序
-    sort(ballContours.begin(), ballContours.end(),
-         [](const vector<Point>& a, const vector<Point>& b) {
-             return contourArea(a) > contourArea(b);
-         });
-
-    int validBalls = 0;
-    Mat originalMarked;
-    cvtColor(visualization, originalMarked, COLOR_GRAY2BGR);
-
-    // 初始化数据包
-    MqttPacket pkt;
-    memset(&pkt, 0, sizeof(MqttPacket));
-
-    for (const auto &cnt : ballContours) {
-        double area = contourArea(cnt);
-        if (area < MIN_BALL_AREA || area > MAX_BALL_AREA) continue;
-        double perim = arcLength(cnt, true);
-        if (perim <= 0) continue;
-        double circularity = 4.0 * CV_PI * area / (perim * perim);
-        if (circularity < MIN_BALL_CIRCULARITY) continue;
-        Rect rect = boundingRect(cnt);
-        double aspect = static_cast<double>(rect.width) / rect.height;
-        if (aspect < 1.0) aspect = 1.0 / aspect;
-        if (aspect > MAX_BALL_ASPECT_RATIO) continue;
-
-        // 记录弹丸信息
-        Point2f center;
-        float radius;
-        minEnclosingCircle(cnt, center, radius);
-        result.ballCenters.push_back(center);
-        result.ballRadii.push_back(radius);
+// ============ 视频源打开 ============
+// 纯数字的源视为摄像头编号，其余视为视频文件路径
+bool is_camera_source(const string& source) {
+    return !source.empty() && all_of(source.begin(), source.end(), ::isdigit);
+}
 
-        // 原始画面标记
-        circle(originalMarked, center, (int)radius, Scalar(255, 255, 255), -1);
-        circle(originalMarked, center, (int)radius + 3, Scalar(0, 255, 0), 3);
+// "shm:NAME" 表示挂载其他进程写入的共享内存帧环形缓冲区
+bool is_shm_source(const string& source) {
+    return source.compare(0, 4, "shm:") == 0;
+}
 
-        if (validBalls < 4) {
-            pkt.balls[validBalls].x = (uint8_t)cvRound(center.x * TARGET_SIZE.width / origW);
-            pkt.balls[validBalls].y = (uint8_t)cvRound(center.y * TARGET_SIZE.height / origH);
-            pkt.balls[validBalls].r = (uint8_t)cvRound(radius * TARGET_SIZE.width / origW);
-            validBalls++;
+bool open_source(const string& source, VideoCapture& cap, double& source_fps) {
+    if (is_camera_source(source)) {
+        cap.open(atoi(source.c_str()));
+        if (!cap.isOpened()) {
+            cerr << "Error: Could not open camera " << source << endl;
+            return false;
+        }
+        cap.set(CAP_PROP_BUFFERSIZE, 1);
+    } else {
+        cap.open(source);
+        if (!cap.isOpened()) {
+            cerr << "Error: Could not open video file: " << source << endl;
+            return false;
         }
     }
+    source_fps = cap.get(CAP_PROP_FPS);
+    if (source_fps <= 0) source_fps = 30.0;
+    cout << "Source " << source << " FPS: " << fixed << setprecision(2) << source_fps << endl;
+    return true;
+}
 
-    // 合并弹丸像素
-    bitwise_or(visualization, greenMask, visualization);
-
-    // 缩放+RLE压缩
-    Mat resized, binary;
-    resize(visualization, resized, TARGET_SIZE, 0, 0, INTER_LINEAR);
-    threshold(resized, binary, 128, 255, THRESH_BINARY);
+// ============ 操作手画面渲染 ============
+void render_operator_view(const ProcessResult& result, Size orig, Mat& displayImg) {
+    int origWidth = orig.width;
+    int origHeight = orig.height;
     
-    pkt.config = 0x01;
-    pkt.width = TARGET_SIZE.width;
-    pkt.height = TARGET_SIZE.height;
-    int rle_len = compressRLE(binary, pkt.rle_data, RLE_DATA_MAX_BYTE);
-    if (rle_len >= RLE_DATA_MAX_BYTE) pkt.config |= 0x02;
-
-    result.finalBinary = binary;
-    result.originalMarked = originalMarked;
-    result.packet = pkt;
-    result.rle_used_byte = rle_len;
-    result.ballCount = validBalls;
+    Mat decoded_small;
+    decodePacketInto(result.packet, result.rle_used_byte, decoded_small);
+    Mat decoded_full;
+    resize(decoded_small, decoded_full,
+           Size(origWidth, origHeight), 0, 0, INTER_NEAREST);
+    Mat decoded_display;
+    cvtColor(decoded_full, decoded_display, COLOR_GRAY2BGR);
     
-    return result;
-}
-
-int HeroCamCompressor::compressRLE(const Mat& img, uint8_t* out_buf, int max_len) {
-    int buf_idx = 0;
-    const uchar *ptr = img.data;
-    int total = img.rows * img.cols;
-    for (int i = 0; i < total && buf_idx + 1 < max_len; ) {
-        uchar val = (ptr[i] > 128) ? 1 : 0; 
-        uint8_t count = 1;
-        while (i + count < total &&
-               ((ptr[i + count] > 128 ? 1 : 0) == val) &&
-               count < 255 &&
-               buf_idx + 1 < max_len)
-            count++;
-        out_buf[buf_idx++] = count;
-        out_buf[buf_idx++] = val;
-        i += count;
-    }
-    return buf_idx;
-}
-
-// ============ 辅助函数实现 ============
-Mat decodeRLE(const uint8_t* rle_data, int rle_len, Size sz) {
-    Mat decoded = Mat::zeros(sz, CV_8UC1);
-    if (rle_len <= 0) return decoded;
-    uchar *ptr = decoded.data;
-    int pixelIdx = 0;
-    int totalPixels = sz.width * sz.height;
-    for (int i = 0; i + 1 < rle_len; i += 2) {
-        uint8_t count = rle_data[i];
-        uint8_t val = rle_data[i + 1];
-        uint8_t pixel_val = (val == 1) ? 255 : 0;
-        for (int j = 0; j < count && pixelIdx < totalPixels; j++)
-            ptr[pixelIdx++] = pixel_val;
-    }
-    return decoded;
+    for (int i = 0; i < 4; i++) {
+        if (result.packet.balls[i].x != 0 || result.packet.balls[i].y != 0) {
+            int real_radius = cvRound(result.packet.balls[i].r *
+                                      origWidth / TARGET_SIZE.width);
+            Point center(
+                cvRound(result.packet.balls[i].x * origWidth / TARGET_SIZE.width),
+                cvRound(result.packet.balls[i].y * origHeight / TARGET_SIZE.height)
+            );
+            circle(decoded_display, center, real_radius,
+                   Scalar(255, 255, 255), -1);
+            circle(decoded_display, center, real_radius + 3,
+                   Scalar(0, 255, 0), 3);
+        }
+    }
+    
+    displayImg.create(origHeight, origWidth * 2, CV_8UC3);
+    result.originalMarked.copyTo(displayImg(Rect(0, 0, origWidth, origHeight)));
+    decoded_display.copyTo(displayImg(Rect(origWidth, 0, origWidth, origHeight)));
+    
+    putText(displayImg, "Original", Point(20, 40),
+            FONT_HERSHEY_SIMPLEX, 1.0, Scalar(0, 0, 255), 2);
+    putText(displayImg, "Decoded", Point(origWidth + 20, 40),
+            FONT_HERSHEY_SIMPLEX, 1.0, Scalar(0, 255, 255), 2);
 }
 
-bool createDir(const string& path) {
-    return system(("mkdir -p " + path).c_str()) == 0;
+// ============ FrameRecorder 成员函数实现 ============
+bool FrameRecorder::open(const string& video_path, const string& frames_dir,
+                         double fps, Size size) {
+    video_path_ = video_path;
+    frames_dir_ = frames_dir;
+    fps_ = fps > 0 ? fps : 30.0;
+    open_failed_ = false;
+    frame_index_ = 0;
+    
+    if (!createDir(frames_dir_)) {
+        cerr << "[错误] 无法创建目录: " << frames_dir_ << endl;
+    }
+    
+    if (size.area() <= 0) return true;  // 第一帧到来时再打开
+    return open_writer(size);
 }
 
-// ============ RingBuffer 成员函数实现 ============
-RingBuffer::RingBuffer(int capacity)
-    : capacity_(capacity), size_(0), head_(0), tail_(0), buffer_(capacity) {}
-
-bool RingBuffer::push(Mat&& frame) {
-    if (size_ >= capacity_) return false;
-    buffer_[tail_] = std::move(frame);
-    tail_ = (tail_ + 1) % capacity_;
-    size_++;
+bool FrameRecorder::open_writer(Size size) {
+    int fourcc = VideoWriter::fourcc('M', 'J', 'P', 'G');
+    writer_.open(video_path_, fourcc, fps_, size, true);
+    if (!writer_.isOpened()) {
+        cerr << "[错误] 无法创建输出视频文件: " << video_path_ << endl;
+        open_failed_ = true;
+        return false;
+    }
     return true;
 }
 
-bool RingBuffer::pop(Mat& frame) {
-    if (size_ == 0) return false;
-    frame = std::move(buffer_[head_]);
-    head_ = (head_ + 1) % capacity_;
-    size_--;
-    return true;
+void FrameRecorder::write(const Mat& frame) {
+    if (!writer_.isOpened() && (open_failed_ || video_path_.empty() || !open_writer(frame.size()))) return;
+    writer_.write(frame);
+    
+    char frame_path[256];
+    sprintf(frame_path, "%s/frame_%06d.png", frames_dir_.c_str(), ++frame_index_);
+    if (pool_) {
+        // PNG编码较慢，交给线程池；在途任务数受限，避免内存无限增长
+        if ((int)pending_writes_.size() >= MAX_PENDING_WRITES) {
+            pool_->wait(pending_writes_.front());
+            pending_writes_.front().get();
+            pending_writes_.pop_front();
+        }
+        Mat snapshot = frame.clone();
+        string path = frame_path;
+        pending_writes_.push_back(pool_->submit([snapshot, path]() {
+            return imwrite(path, snapshot);
+        }));
+    } else {
+        imwrite(frame_path, frame);
+    }
 }
 
-int RingBuffer::size() const { return size_; }
-int RingBuffer::capacity() const { return capacity_; }
-bool RingBuffer::empty() const { return size_ == 0; }
-bool RingBuffer::full() const { return size_ >= capacity_; }
-
-// ============ 单线程模式实现 ============
-void run_single_thread_mode(const string& source) {
-    VideoCapture cap(source);
-    if (!cap.isOpened()) {
-        cerr << "Error: Could not open video file: " << source << endl;
-        return;
+void FrameRecorder::close() {
+    for (auto& w : pending_writes_) {
+        pool_->wait(w);
+        w.get();
     }
+    pending_writes_.clear();
+    if (writer_.isOpened()) {
+        writer_.release();
+        cout << "Output video saved to: " << video_path_ << endl;
+        cout << "Frames saved to: " << frames_dir_ << endl;
+    }
+}
+
+// ============ 统计输出 ============
+void print_stats(PerfStats& stats, double elapsed_sec, const string& label) {
+    if (stats.frame_times.empty()) return;
     
-    double video_fps = cap.get(CAP_PROP_FPS);
-    if (video_fps <= 0) video_fps = 30.0;
-    cout << "Video FPS: " << fixed << setprecision(2) << video_fps << endl;
-    
-    int origWidth = (int)cap.get(CAP_PROP_FRAME_WIDTH);
-    int origHeight = (int)cap.get(CAP_PROP_FRAME_HEIGHT);
-    
-    long custom_spf = (long)(1000.0 / video_fps);
-    
-    HeroCamCompressor compressor;
-    Mat frame;
-    ProcessResult result;
-    
-    const string OUTPUT_VIDEO_PATH = "output_video.avi";
-    const string OUTPUT_FRAMES_DIR = "output_frames/";
+    double fps = elapsed_sec > 0 ? stats.frame_times.size() / elapsed_sec : 0.0;
+    int max_rle_used = *max_element(stats.compressed_sizes.begin(),
+                                     stats.compressed_sizes.end());
+    double avg_time = accumulate(stats.frame_times.begin(),
+                                 stats.frame_times.end(), 0L) / 1000.0 /
+                      stats.frame_times.size();
     
-    if (!createDir(OUTPUT_FRAMES_DIR)) {
-        cerr << "[错误] 无法创建目录: " << OUTPUT_FRAMES_DIR << endl;
+    // 检查最大值是否接近或超过RLE数据区上限
+    if (max_rle_used >= RLE_DATA_MAX_BYTE) {
+        cout << "[警告] " << label << " RLE数据最大值达到或超过上限 (" << max_rle_used
+             << "/" << RLE_DATA_MAX_BYTE << " 字节)" << endl;
     }
     
-    int fourcc = VideoWriter::fourcc('M', 'J', 'P', 'G');
-    VideoWriter writer(OUTPUT_VIDEO_PATH, fourcc, video_fps,
-                       Size(origWidth * 2, origHeight), true);
-    if (!writer.isOpened()) {
-        cerr << "[错误] 无法创建输出视频文件: " << OUTPUT_VIDEO_PATH << endl;
+    cout << "\n[" << label << " Frame " << stats.total_frames << "] ===== STATISTICS =====" << endl;
+    cout << "FPS: " << fixed << setprecision(1) << fps << " fps" << endl;
+    cout << "Packet Size (fixed): " << sizeof(MqttPacket) << " bytes" << endl;
+    cout << "Raw Binary Size: " << TARGET_SIZE.width << " x " << TARGET_SIZE.height 
+         << " = " << TARGET_SIZE.area() << " bytes (fixed)" << endl;
+    cout << "RLE Data Max Used: " << max_rle_used << " / " 
+         << RLE_DATA_MAX_BYTE << " bytes" << endl;
+    cout << "Avg Process Time: " << setprecision(2) << avg_time << " ms" << endl;
+    long n = stats.capture_latencies.size();
+    if (n > 0) {
+        cout << "Avg Capture->Result Latency: " << setprecision(2)
+             << accumulate(stats.capture_latencies.begin(),
+                           stats.capture_latencies.end(), 0L) / 1000.0 / n
+             << " ms (queue wait " << stats.queue_wait_us / 1000.0 / n << " ms)" << endl;
     }
-    
-    const string window_name = "Operator View (Single-thread)";
-    namedWindow(window_name, WINDOW_NORMAL);
-    resizeWindow(window_name, 1280, 480);
-    
-    Mat displayImg;
-    displayImg.create(origHeight, origWidth * 2, CV_8UC3);
-    
-    int total_frames = 0;
-    vector<int> rle_used_sizes;   // 存储RLE实际使用字节数
-    vector<int> raw_binary_sizes;  // [新增] 存储压缩前binary每帧大小
-    vector<long> frame_times;
-    auto last_log_time = high_resolution_clock::now();
-    
-    uint8_t frame_seq = 0;
-    
-    cout << "单包固定大小: " << sizeof(MqttPacket) << " 字节 (其中RLE数据区最大 " 
-         << RLE_DATA_MAX_BYTE << " 字节)" << endl;
-    
-    while (cap.read(frame)) {
-        if (frame.empty()) continue;
-        frame_seq++;
-        
-        auto start = high_resolution_clock::now();
-        
-        try {
-            result = compressor.process(frame);
-            result.packet.frame_seq = frame_seq;
-            
-            // [新增] 计算压缩前binary大小 (TARGET_SIZE为固定尺寸，每像素1字节)
-            int raw_size = TARGET_SIZE.width * TARGET_SIZE.height;
-            raw_binary_sizes.push_back(raw_size);
-            
-            Mat decoded_small = decodeRLE(result.packet.rle_data,
-                                          RLE_DATA_MAX_BYTE, TARGET_SIZE);
-            Mat decoded_full;
-            resize(decoded_small, decoded_full,
-                   Size(origWidth, origHeight), 0, 0, INTER_NEAREST);
-            Mat decoded_display;
-            cvtColor(decoded_full, decoded_display, COLOR_GRAY2BGR);
-            
-            for (int i = 0; i < 4; i++) {
-                if (result.packet.balls[i].x != 0 || result.packet.balls[i].y != 0) {
-                    int real_radius = cvRound(result.packet.balls[i].r *
-                                              origWidth / TARGET_SIZE.width);
-                    Point center(
-                        cvRound(result.packet.balls[i].x * origWidth / TARGET_SIZE.width),
-                        cvRound(result.packet.balls[i].y * origHeight / TARGET_SIZE.height)
-                    );
-                    circle(decoded_display, center, real_radius,
-                           Scalar(255, 255, 255), -1);
-                    circle(decoded_display, center, real_radius + 3,
-                           Scalar(0, 255, 0), 3);
-                }
-            }
-            
-            result.originalMarked.copyTo(displayImg(Rect(0, 0, origWidth, origHeight)));
-            decoded_display.copyTo(displayImg(Rect(origWidth, 0, origWidth, origHeight)));
-            
-            putText(displayImg, "Original", Point(20, 40),
-                    FONT_HERSHEY_SIMPLEX, 1.0, Scalar(0, 0, 255), 2);
-            putText(displayImg, "Decoded", Point(origWidth + 20, 40),
-                    FONT_HERSHEY_SIMPLEX, 1.0, Scalar(0, 255, 255), 2);
-            
-            imshow(window_name, displayImg);
-            
-            if (writer.isOpened()) {
-                writer.write(displayImg);
-                char frame_path[256];
-                sprintf(frame_path, "%s/frame_%06d.png",
-                        OUTPUT_FRAMES_DIR.c_str(), total_frames + 1);
-                imwrite(frame_path, displayImg);
-            }
-            
-            int key = waitKey(1);
-            if (key == 27 || key == 'q' || key == 'Q') break;
-            
-            total_frames++;
-            rle_used_sizes.push_back(result.rle_used_byte);
-            frame_times.push_back(duration_cast<milliseconds>(
-                high_resolution_clock::now() - start).count());
-            
-            auto now = high_resolution_clock::now();
-            if (duration_cast<seconds>(now - last_log_time).count() >= 5) {
-                double fps = 1000.0 / custom_spf;
-                int max_rle_used = *max_element(rle_used_sizes.begin(), rle_used_sizes.end());
-                // [新增] 计算压缩前binary的最大值（实际上恒定）
-                int max_raw_binary = *max_element(raw_binary_sizes.begin(), raw_binary_sizes.end());
-                long avg_time = accumulate(frame_times.begin(),
-                                           frame_times.end(), 0L) /
-                               (frame_times.empty() ? 1 : frame_times.size());
-                
-                // 检查最大值是否接近或超过RLE数据区上限
-                if (max_rle_used >= RLE_DATA_MAX_BYTE) {
-                    cout << "[警告] RLE数据最大值达到或超过上限 (" << max_rle_used
-                         << "/" << RLE_DATA_MAX_BYTE << " 字节)" << endl;
-                }
-                
-                cout << "\n[Frame " << total_frames << "] ===== STATISTICS =====" << endl;
-                cout << "FPS: " << fixed << setprecision(1) << fps << " fps" << endl;
-                cout << "Packet Size (fixed): " << sizeof(MqttPacket) << " bytes" << endl;
-                // [新增] 输出压缩前binary大小
-                cout << "Raw Binary Size: " << TARGET_SIZE.width << " x " << TARGET_SIZE.height 
-                     << " = " << max_raw_binary << " bytes (fixed)" << endl;
-                cout << "RLE Data Max Used: " << max_rle_used << " / " 
-                     << RLE_DATA_MAX_BYTE << " bytes" << endl;
-                cout << "Avg Process Time: " << avg_time << " ms" << endl;
-                cout << "========================" << endl;
-                
-                last_log_time = now;
-                frame_times.clear();
-                rle_used_sizes.clear();
-                raw_binary_sizes.clear();  // [新增] 清空以便下一周期
-            }
-            
-        } catch (const exception& e) {
-            cerr << "Error processing frame: " << e.what() << endl;
-        }
-        
-        auto end = high_resolution_clock::now();
-        auto dur = duration_cast<milliseconds>(end - start);
-        long sleep_time = custom_spf - dur.count();
-        if (sleep_time > 2) {
-            this_thread::sleep_for(milliseconds(sleep_time));
+    cout << "Skipped / Dropped Frames: " << stats.skipped << " / " << stats.dropped << endl;
+    cout << "Stage Time (us)       p50      p90      p99      max";
+    if (ALLOC_STATS_ENABLED) cout << "  allocs/f     KB/f";
+    cout << endl;
+    for (int k = 0; k < STAGE_COUNT; k++) {
+        const LatencyHistogram& h = stats.stages[k];
+        if (h.count() == 0) continue;
+        cout << "  " << left << setw(14) << stage_name(k) << right
+             << setw(9) << h.percentile(50) << setw(9) << h.percentile(90)
+             << setw(9) << h.percentile(99) << setw(9) << h.max();
+        if (ALLOC_STATS_ENABLED) {
+            cout << setprecision(1) << setw(10) << (double)stats.stage_allocs[k] / h.count()
+                 << setw(9) << stats.stage_alloc_bytes[k] / 1024.0 / h.count();
         }
+        cout << endl;
     }
+    cout << "========================" << endl;
     
-    cap.release();
-    writer.release();
-    destroyAllWindows();
-    
-    cout << "Single-thread mode completed. Total frames: " << total_frames << endl;
-    cout << "Output video saved to: " << OUTPUT_VIDEO_PATH << endl;
-    cout << "Frames saved to: " << OUTPUT_FRAMES_DIR << endl;
+    stats.frame_times.clear();
+    stats.compressed_sizes.clear();
+    stats.capture_latencies.clear();
+    stats.queue_wait_us = 0;
+    for (auto& h : stats.stages) h.reset();
+    for (int k = 0; k < STAGE_COUNT; k++) {
+        stats.stage_allocs[k] = 0;
+        stats.stage_alloc_bytes[k] = 0;
+    }
 }
 
-// ============ 摄像头线程函数实现 ============
-int camera_thread_func(const string& source) {
-    VideoCapture cap;
-    double source_fps = 30.0;
-    
-    if (source == "0") {
-        cap.open(0);
-        if (!cap.isOpened()) {
-            cerr << "Error: Could not open camera" << endl;
-            return -1;
-        }
-        cap.set(CAP_PROP_BUFFERSIZE, 1);
-        source_fps = cap.get(CAP_PROP_FPS);
-    } else {
-        cap.open(source);
-        if (!cap.isOpened()) {
-            cerr << "Error: Could not open video file: " << source << endl;
-            return -1;
-        }
-        source_fps = cap.get(CAP_PROP_FPS);
-        cout << "Video FPS: " << source_fps << endl;
+void print_sender_stats(DualRateSender& sender, double elapsed_sec, long budget_bytes_per_sec) {
+    const SenderStats& ss = sender.stats();
+    if (elapsed_sec <= 0) return;
+    cout << "Link: map " << ss.map_packets << " pkt (" << fixed << setprecision(1)
+         << ss.map_packets / elapsed_sec << " Hz), ball " << ss.ball_packets << " pkt (predicted "
+         << ss.predicted_packets << "), " << setprecision(0) << ss.bytes / elapsed_sec << " B/s";
+    if (budget_bytes_per_sec > 0) {
+        cout << " / budget " << budget_bytes_per_sec << " B/s (util " << setprecision(1)
+             << 100.0 * ss.bytes / elapsed_sec / budget_bytes_per_sec << "%), deferred maps "
+             << ss.deferred_maps << ", skipped frames " << ss.skipped_frames;
     }
+    if (ss.parity_packets || ss.parity_skipped) {
+        cout << ", parity " << ss.parity_packets << " pkt (skipped " << ss.parity_skipped << ")";
+    }
+    cout << endl;
+    sender.reset_stats();
+}
 
-    Mat frame;
-    int frame_count = 0;
+// 唤醒调度线程：有新帧入队、有处理结果产出或某路采集结束
+static uint64_t pipeline_events = 0;  // 受pipeline_mutex保护
+
+static void notify_pipeline() {
+    {
+        lock_guard<mutex> lock(pipeline_mutex);
+        pipeline_events++;
+    }
+    frame_available.notify_all();
+}
+
+// ============ 摄像头线程函数实现 ============
+int camera_thread_func(FrameStream& stream) {
+    VideoCapture& cap = stream.cap;
+    bool is_file = !is_camera_source(stream.source);
+    FrameEnvelope frame;
+    int frame_count = 0;      // 源帧序号（含跳过的帧）
+    int grabbed_count = 0;    // 实际grab()的帧数（不含seek越过的帧）
+    int retrieved_count = 0;  // 实际解码(retrieve)的帧数
+    uint32_t skipped = 0;     // 自上次入队以来跳过的帧数
+    uint32_t dropped = 0;     // 自上次入队以来丢弃的帧数
+    auto first_grab_time = steady_clock::now();
+    auto last_grab_time = first_grab_time;
+    tracer_set_thread_name("capture " + stream.label);
     
     while (running) {
-        if (!cap.read(frame)) break;
-        if (frame.empty()) continue;
+        // 视频文件跳帧较大时直接seek，比逐帧grab更省
+        if (is_file && frame_skip >= FILE_SEEK_MIN_SKIP && frame_count % frame_skip != 0) {
+            int next = frame_count + frame_skip - frame_count % frame_skip;
+            skipped += next - frame_count;
+            frame_count = next;
+            cap.set(CAP_PROP_POS_FRAMES, frame_count);
+        }
+        
+        // grab()只取数据不做解码/色彩转换，每帧在此打时间戳
+        {
+            TraceScope trace("grab", frame_count);
+            if (!cap.grab()) break;
+        }
+        last_grab_time = steady_clock::now();
+        int64_t capture_us = monotonic_us();
+        if (grabbed_count++ == 0) first_grab_time = last_grab_time;
         
         if (frame_count % frame_skip != 0) {
             frame_count++;
+            skipped++;
+            continue;
+        }
+        
+        // 只有真正要处理的帧才retrieve()
+        bool retrieved;
+        {
+            TraceScope trace("retrieve", frame_count);
+            retrieved = cap.retrieve(frame.image) && !frame.image.empty();
+        }
+        if (!retrieved) {
+            frame_count++;
+            dropped++;
             continue;
         }
+        retrieved_count++;
+        
+        frame.meta = FrameMeta();
+        frame.meta.stream_id = stream.id;
+        frame.meta.capture_us = capture_us;
+        frame.meta.retrieve_us = monotonic_us();
+        frame.meta.source_seq = frame_count;
+        frame.meta.skipped = skipped;
+        frame.meta.dropped = dropped;
         
         {
-            unique_lock<mutex> lock(camera_mutex);
-            queue_not_full.wait(lock, []{ return !running || !frame_queue.full(); });
+            TraceScope trace("enqueue", frame_count);  // 含队列满时的阻塞等待
+            unique_lock<mutex> lock(stream.mutex);
+            stream.queue_not_full.wait(lock, [&stream]{ return !running || !stream.queue.full(); });
             if (!running) break;
-            if (!frame_queue.push(std::move(frame))) {
+            frame.meta.enqueue_us = monotonic_us();
+            trace_counter("queue depth", stream.id, stream.queue.size() + 1);
+            if (stream.queue.push(std::move(frame))) {
+                skipped = 0;
+                dropped = 0;
+            } else {
                 cerr << "Failed to push frame to queue" << endl;
+                dropped++;
             }
-            lock.unlock();
-            frame_available.notify_one();
         }
+        notify_pipeline();
         
         frame_count++;
     }
     
-    {
-        lock_guard<mutex> lock(camera_mutex);
-        running = false;
-        frame_available.notify_all();
-        queue_not_full.notify_all();
-    }
-    
     cap.release();
+    stream.eof = true;
+    notify_pipeline();
+    
+    double elapsed = duration_cast<duration<double>>(last_grab_time - first_grab_time).count();
+    cout << "Capture #" << stream.id << " finished. Source frames: " << frame_count
+         << ", Grabbed: " << grabbed_count << ", Retrieved: " << retrieved_count;
+    if (elapsed > 0) {
+        cout << ", Grab FPS: " << fixed << setprecision(1) << (grabbed_count - 1) / elapsed;
+    }
+    cout << endl;
     return 0;
 }
 
-// ============ 主函数 ============
-int main() {
-    cout << "=== Image Source Selection ===" << endl;
-    cout << "1. Camera (Multi-thread mode) (press 1)" << endl;
-    cout << "2. Video File (Single-thread mode) (press 2)" << endl;
-    cout << "Please select (1 or 2): ";
+// ============ 共享内存采集线程 ============
+// 帧直接指向共享内存，不拷贝不解码；处理完成后再用still_valid()确认未被写端覆盖
+int shm_thread_func(FrameStream& stream) {
+    FrameEnvelope frame;
+    long received = 0;
+    tracer_set_thread_name("capture " + stream.label);
+    while (running) {
+        if (!stream.shm->next(frame, 100)) continue;
+        frame.meta.stream_id = stream.id;
+        received++;
+        {
+            TraceScope trace("enqueue", frame.meta.source_seq);
+            unique_lock<mutex> lock(stream.mutex);
+            stream.queue_not_full.wait(lock, [&stream]{ return !running || !stream.queue.full(); });
+            if (!running) break;
+            frame.meta.enqueue_us = monotonic_us();
+            stream.queue.push(std::move(frame));
+        }
+        notify_pipeline();
+    }
+    stream.eof = true;
+    notify_pipeline();
+    cout << "Capture #" << stream.id << " (shm) finished. Frames: " << received << endl;
+    return 0;
+}
+
+// ============ FrameStream 成员函数实现 ============
+FrameStream::FrameStream(int stream_id, const string& src, int depth, const SenderConfig& sender_cfg)
+    : id(stream_id), source(src), queue(max(1, depth)), sender(sender_cfg) {}
+
+// ============ 流水线主循环 ============
+// 每路视频源一个采集线程和帧队列，处理统一提交到共享线程池；
+// 视频文件的解码与处理重叠进行，队列深度即预取帧数
+int run_pipeline(const PipelineOptions& opt, ThreadPool& pool) {
+    if (opt.sources.empty() || (int)opt.sources.size() > MAX_STREAMS) {
+        cerr << "Error: need 1.." << MAX_STREAMS << " sources" << endl;
+        return -1;
+    }
+    bool multi = opt.sources.size() > 1;
     
-    char choice;
-    cin >> choice;
+    vector<unique_ptr<FrameStream>> streams;
+    for (size_t i = 0; i < opt.sources.size(); i++) {
+        unique_ptr<FrameStream> s(new FrameStream((int)i, opt.sources[i], opt.prefetch_depth, opt.sender));
+        if (is_shm_source(s->source)) {
+            s->shm.reset(new ShmFrameReader());
+            if (!s->shm->attach(s->source.substr(4))) {
+                cerr << "Error: Could not attach shared memory: " << s->source << endl;
+                return -1;
+            }
+            s->frame_interval_us = 0;  // 写端已按实时节奏产出，不再节拍
+        } else {
+            if (!open_source(s->source, s->cap, s->fps)) return -1;
+            s->size = Size((int)s->cap.get(CAP_PROP_FRAME_WIDTH), (int)s->cap.get(CAP_PROP_FRAME_HEIGHT));
+            s->frame_interval_us = (int64_t)(1e6 / s->fps);
+        }
+        s->compressor.setThreadPool(&pool);
+        s->compressor.setResyncRows(opt.resync_rows);
+        s->label = "Stream " + to_string(i);
+        s->window_name = is_shm_source(s->source) ? "Operator View (Shm" :
+                         is_camera_source(s->source) ? "Operator View (Camera" : "Operator View (File";
+        s->window_name += multi ? " #" + to_string(i) + ")" : ")";
+        if (opt.record) {
+            s->recorder.reset(new FrameRecorder(&pool));
+            string suffix = multi ? "_" + to_string(i) : "";
+            // 共享内存源的尺寸要等第一帧才知道，由录制器按首个操作手画面打开；帧率取默认值
+            Size record_size = s->shm ? Size() : Size(s->size.width * 2, s->size.height);
+            s->recorder->open("output_video" + suffix + ".avi", "output_frames" + suffix + "/",
+                              s->fps, record_size);
+        }
+        if (opt.display) {
+            namedWindow(s->window_name, WINDOW_NORMAL);
+            resizeWindow(s->window_name, 1280, 480);
+        }
+        streams.push_back(std::move(s));
+    }
     
-    string source;
-    bool use_camera = false;
+    // 所有视频流共用一条链路，带宽预算由一个令牌桶统一分配；容量按流数放大，
+    // 各路同一时刻到期的地图包（连同校验包）都能发出
+    long link_burst = opt.sender.burst_bytes * (long)streams.size();
+    TokenBucket link_budget(opt.sender.budget_bytes_per_sec, link_burst);
+    double ball_load = 0;
+    for (auto& s : streams) {
+        if (link_budget.enabled()) s->sender.setTokenBucket(&link_budget);
+        double ball_rate = opt.sender.ball_rate_hz > 0 ? opt.sender.ball_rate_hz : s->fps > 0 ? s->fps : 30.0;
+        ball_load += ball_rate * BALL_PACKET_BYTE;
+    }
     
-    if (choice == '1') {
-        source = "0";
-        use_camera = true;
-        cout << "Using camera as source (Multi-thread mode)..." << endl;
-    } else {
-        source = "../vid/test_video3.avi";  // 默认视频文件路径
-        cout << "Using video file (Single-thread mode): " << source << endl;
+    unique_ptr<MqttPublisher> publisher;
+    if (!opt.mqtt_broker.empty()) {
+        MqttConfig mc;
+        parse_broker(opt.mqtt_broker, mc);
+        mc.topic = opt.mqtt_topic;
+        publisher.reset(new MqttPublisher(mc));
+        cout << "Publishing to mqtt://" << mc.host << ":" << mc.port << "/" << mc.topic << "/<stream>/{map,ball}" << endl;
     }
     
-    cout << endl;
+    unique_ptr<UdpSender> udp;
+    if (!opt.udp_target.empty()) {
+        udp.reset(new UdpSender());
+        if (!udp->open(opt.udp_target)) return -1;
+        cout << "Sending UDP to " << opt.udp_target << endl;
+    }
     
-    if (use_camera) {
-        // 多线程模式
-        cout << "[Multi-thread mode] Starting..." << endl;
-        running = true;
-        
-        thread camera_thread(camera_thread_func, source);
-        
-        HeroCamCompressor compressor;
-        ProcessResult result;
-        long custom_spf = 33;  // 约30fps
-        
-        const string window_name = "Operator View (Multi-thread)";
-        namedWindow(window_name, WINDOW_NORMAL);
-        resizeWindow(window_name, 1280, 480);
-        
-        int origWidth = 640, origHeight = 480;  // 默认，随后从第一帧更新
-        Mat displayImg;
-        
-        // [新增] 多线程模式统计变量
-        struct {
-            int total_frames = 0;
-            vector<long> frame_times;
-            vector<int> compressed_sizes;   // RLE压缩后大小
-            vector<int> raw_binary_sizes;    // 压缩前binary大小
-        } stats;
-        
-        auto last_log_time = high_resolution_clock::now();
-        
-        cout << "单包固定大小: " << sizeof(MqttPacket) << " 字节 (其中RLE数据区最大 " 
-             << RLE_DATA_MAX_BYTE << " 字节)" << endl;
+    PacketLogWriter packet_log;
+    if (!opt.packet_log.empty()) {
+        if (!packet_log.open(opt.packet_log)) return -1;
+        cout << "Logging packets to " << opt.packet_log << endl;
+    }
+    
+    if (!opt.trace_path.empty()) {
+        if (!tracer_open(opt.trace_path)) return -1;
+        cout << "Tracing to " << opt.trace_path << " (kill -USR1 " << getpid() << " to flush)" << endl;
+    }
+    tracer_set_thread_name("scheduler");
+    
+    // 所有可能失败返回的初始化都在此之前完成：采集线程一旦启动，提前返回会析构仍可join的std::thread
+    running = true;
+    for (auto& s : streams) {
+        s->capture_thread = s->shm ? thread(shm_thread_func, std::ref(*s))
+                                   : thread(camera_thread_func, std::ref(*s));
+    }
+    
+    deque<ProcessResult> results;  // 处理完成待显示的结果，受pipeline_mutex保护
+    vector<OutPacket> outbox;      // 本轮待发送的数据包
+    Mat displayImg;
+    auto last_log_time = high_resolution_clock::now();
+    size_t rr = 0;  // 轮询起点，每轮后移一位保证各路公平
+    
+    cout << "单包固定大小: " << sizeof(MqttPacket) << " 字节 (其中RLE数据区最大 " 
+         << RLE_DATA_MAX_BYTE << " 字节)" << endl;
+    cout << "Streams: " << streams.size() << ", prefetch depth: " << max(1, opt.prefetch_depth)
+         << (opt.fast ? ", pacing: off (fast)" : ", pacing: source fps") << endl;
+    cout << "Map packets: up to " << opt.sender.map_rate_hz << " Hz, ball packets: "
+         << (opt.sender.ball_rate_hz > 0 ? to_string((int)opt.sender.ball_rate_hz) + " Hz" : "every frame")
+         << endl;
+    if (opt.sender.fec_group > 0 || opt.resync_rows > 0) {
+        cout << "Loss resilience: parity every " << opt.sender.fec_group << " map packets, resync every "
+             << opt.resync_rows << " rows (0 = off)" << endl;
+    }
+    if (link_budget.enabled()) {
+        cout << "Link budget: " << link_budget.rate() << " B/s shared by " << streams.size()
+             << " stream(s), token bucket burst " << link_burst << " B" << endl;
+        if (link_budget.rate() < ball_load) {
+            cerr << "[警告] 带宽预算不足以按帧率发送弹丸包，部分帧将不发送" << endl;
+        }
+    }
+    
+    while (running) {
+        uint64_t seen_events;
+        {
+            lock_guard<mutex> lock(pipeline_mutex);
+            seen_events = pipeline_events;
+        }
         
-        while(running) {
-            auto start = high_resolution_clock::now();
+        // 1. 派发：每路每轮最多派发一帧，且同一路同时只有一帧在处理（保证按序、压缩器状态不被并发访问）
+        int64_t now_us = monotonic_us();
+        for (size_t k = 0; k < streams.size(); k++) {
+            FrameStream& s = *streams[(rr + k) % streams.size()];
+            if (s.busy) continue;
+            if (!opt.fast && now_us < s.next_due_us) continue;
             
-            Mat frame;
+            shared_ptr<FrameEnvelope> frame = make_shared<FrameEnvelope>();
             {
-                unique_lock<mutex> lock(camera_mutex);
-                frame_available.wait_for(lock, milliseconds(50), []{
-                    return !running || !frame_queue.empty();
-                });
-                if (!running && frame_queue.empty()) break;
-                if (frame_queue.empty()) continue;
-                if (!frame_queue.pop(frame)) continue;
-                lock.unlock();
-                queue_not_full.notify_one();
+                lock_guard<mutex> lock(s.mutex);
+                if (!s.queue.pop(*frame)) continue;
             }
+            s.queue_not_full.notify_one();
+            frame->meta.dequeue_us = now_us;
+            s.next_due_us = now_us + s.frame_interval_us;
+            s.busy = true;
             
-            if (frame.empty()) continue;
-            
-            // 更新分辨率（基于第一帧）
-            if (origWidth == 640 && origHeight == 480) {
-                origWidth = frame.cols;
-                origHeight = frame.rows;
-            }
-            
-            try {
-                result = compressor.process(frame);
-                
-                // [新增] 记录压缩前binary大小
-                int raw_size = TARGET_SIZE.width * TARGET_SIZE.height;
-                stats.raw_binary_sizes.push_back(raw_size);
-                
-                Mat decoded_small = decodeRLE(result.packet.rle_data,
-                                              RLE_DATA_MAX_BYTE, TARGET_SIZE);
-                Mat decoded_full;
-                resize(decoded_small, decoded_full,
-                       Size(origWidth, origHeight), 0, 0, INTER_NEAREST);
-                Mat decoded_display;
-                cvtColor(decoded_full, decoded_display, COLOR_GRAY2BGR);
-                
-                for (int i = 0; i < 4; i++) {
-                    if (result.packet.balls[i].x != 0 || result.packet.balls[i].y != 0) {
-                        int real_radius = cvRound(result.packet.balls[i].r *
-                                                  origWidth / TARGET_SIZE.width);
-                        Point center(
-                            cvRound(result.packet.balls[i].x * origWidth / TARGET_SIZE.width),
-                            cvRound(result.packet.balls[i].y * origHeight / TARGET_SIZE.height)
-                        );
-                        circle(decoded_display, center, real_radius,
-                               Scalar(255, 255, 255), -1);
-                        circle(decoded_display, center, real_radius + 3,
-                               Scalar(0, 255, 0), 3);
+            FrameStream* sp = &s;
+            s.inflight = pool.submit([sp, frame, &results]() {
+                ProcessResult r;
+                bool ok = false;
+                try {
+                    r = sp->compressor.process(*frame);
+                    if (sp->shm && !sp->shm->still_valid(*frame)) {
+                        // 处理期间slot被写端覆盖，结果可能混入两帧数据，丢弃
+                        lock_guard<mutex> lock(pipeline_mutex);
+                        sp->stats.dropped++;
+                    } else {
+                        r.packet.frame_seq = ++sp->frame_seq;  // 每路独立的序号空间
+                        packet_seal(r.packet);
+                        ok = true;
                     }
+                } catch (const exception& e) {
+                    cerr << "Error processing frame (stream " << sp->id << "): " << e.what() << endl;
                 }
-                
-                displayImg.create(origHeight, origWidth * 2, CV_8UC3);
-                result.originalMarked.copyTo(displayImg(Rect(0, 0, origWidth, origHeight)));
-                decoded_display.copyTo(displayImg(Rect(origWidth, 0, origWidth, origHeight)));
-                
-                putText(displayImg, "Original", Point(20, 40),
-                        FONT_HERSHEY_SIMPLEX, 1.0, Scalar(0, 0, 255), 2);
-                putText(displayImg, "Decoded", Point(origWidth + 20, 40),
-                        FONT_HERSHEY_SIMPLEX, 1.0, Scalar(0, 255, 255), 2);
-                
-                imshow(window_name, displayImg);
-                
-                int key = waitKey(1);
-                if (key == 27 || key == 'q' || key == 'Q') {
-                    running = false;
-                    break;
+                {
+                    lock_guard<mutex> lock(pipeline_mutex);
+                    if (ok) results.push_back(std::move(r));
+                    sp->busy = false;
+                    pipeline_events++;
                 }
-                
-                stats.frame_times.push_back(duration_cast<milliseconds>(
-                    high_resolution_clock::now() - start).count());
-                stats.compressed_sizes.push_back(result.rle_used_byte);
-                stats.total_frames++;
-                
-                auto now = high_resolution_clock::now();
-                if (duration_cast<seconds>(now - last_log_time).count() >= 5) {
-                    double fps = 1000.0 / 33.0;  // 假设30FPS
-                    int max_rle_used = *max_element(stats.compressed_sizes.begin(),
-                                                     stats.compressed_sizes.end());
-                    int max_raw_binary = *max_element(stats.raw_binary_sizes.begin(),
-                                                       stats.raw_binary_sizes.end());
-                    long avg_time = accumulate(stats.frame_times.begin(),
-                                               stats.frame_times.end(), 0L) /
-                                   (stats.frame_times.empty() ? 1 :
-                                    stats.frame_times.size());
-                    
-                    if (max_rle_used >= RLE_DATA_MAX_BYTE) {
-                        cout << "[警告] RLE数据最大值达到或超过上限 (" << max_rle_used
-                             << "/" << RLE_DATA_MAX_BYTE << " 字节)" << endl;
-                    }
-                    
-                    cout << "\n[Frame " << stats.total_frames << "] ===== STATISTICS =====" << endl;
-                    cout << "FPS: " << fixed << setprecision(1) << fps << " fps" << endl;
-                    cout << "Packet Size (fixed): " << sizeof(MqttPacket) << " bytes" << endl;
-                    // [新增] 输出压缩前binary大小
-                    cout << "Raw Binary Size: " << TARGET_SIZE.width << " x " << TARGET_SIZE.height 
-                         << " = " << max_raw_binary << " bytes (fixed)" << endl;
-                    cout << "RLE Data Max Used: " << max_rle_used << " / " 
-                         << RLE_DATA_MAX_BYTE << " bytes" << endl;
-                    cout << "Avg Process Time: " << avg_time << " ms" << endl;
-                    cout << "========================" << endl;
-                    
-                    last_log_time = now;
-                    stats.frame_times.clear();
-                    stats.compressed_sizes.clear();
-                    stats.raw_binary_sizes.clear();  // [新增] 清空
+                frame_available.notify_all();
+            });
+        }
+        rr = (rr + 1) % streams.size();
+        
+        // 2. 取出处理结果：显示、录制、统计
+        deque<ProcessResult> ready;
+        {
+            lock_guard<mutex> lock(pipeline_mutex);
+            ready.swap(results);
+        }
+        for (auto& r : ready) {
+            FrameStream& s = *streams[r.meta.stream_id];
+            Size orig = s.size;
+            if (orig.width <= 0 || orig.height <= 0) orig = r.originalMarked.size();
+            
+            PerfStats& st = s.stats;
+            r.stages.us[STAGE_CAPTURE] = (int32_t)(r.meta.retrieve_us - r.meta.capture_us);
+            r.stages.us[STAGE_QUEUE] = (int32_t)(r.meta.dequeue_us - r.meta.enqueue_us);
+            r.stages.us[STAGE_PROCESS] = (int32_t)(r.meta.process_end_us - r.meta.process_start_us);
+            if (opt.display || opt.record) {
+                ScopedTimer timer(&r.stages, STAGE_DISPLAY);
+                render_operator_view(r, orig, displayImg);
+                if (opt.display) imshow(s.window_name, displayImg);
+            }
+            if (s.recorder) {
+                ScopedTimer timer(&r.stages, STAGE_RECORD);
+                s.recorder->write(displayImg);
+            }
+            
+            if (ALLOC_STATS_ENABLED) {
+                // process()整体的分配按其内部各阶段求和（弹丸分支在另一线程上计数）
+                for (int k = STAGE_GRAY; k <= STAGE_ENCODE; k++) {
+                    r.stages.allocs[STAGE_PROCESS] += r.stages.allocs[k];
+                    r.stages.alloc_bytes[STAGE_PROCESS] += r.stages.alloc_bytes[k];
                 }
-                
-            } catch (const exception& e) {
-                cerr << "Error: " << e.what() << endl;
             }
+            for (int k = 0; k < STAGE_COUNT; k++) {
+                if (r.stages.us[k] >= 0) st.stages[k].record(r.stages.us[k]);
+                st.stage_allocs[k] += r.stages.allocs[k];
+                st.stage_alloc_bytes[k] += r.stages.alloc_bytes[k];
+            }
+            st.frame_times.push_back(r.meta.process_end_us - r.meta.process_start_us);
+            st.compressed_sizes.push_back(r.rle_used_byte);
+            st.capture_latencies.push_back(r.meta.process_end_us - r.meta.capture_us);
+            st.queue_wait_us += r.meta.dequeue_us - r.meta.enqueue_us;
+            st.skipped += r.meta.skipped;
+            st.dropped += r.meta.dropped;
+            st.total_frames++;
             
-            auto end = high_resolution_clock::now();
-            auto dur = duration_cast<milliseconds>(end - start);
-            long sleep_time = custom_spf - dur.count();
-            if (sleep_time > 2) {
-                this_thread::sleep_for(milliseconds(sleep_time));
+            s.sender.on_frame(r, monotonic_us(), outbox);
+        }
+        int64_t poll_us = monotonic_us();
+        for (auto& s : streams) s->sender.poll(poll_us, outbox);
+        if (!outbox.empty()) {
+            TraceScope trace("send");
+            if (publisher) {
+                for (const OutPacket& p : outbox) publisher->publish(p);
+            }
+            if (udp) udp->send(outbox);
+            if (packet_log.is_open()) {
+                for (const OutPacket& p : outbox) packet_log.append(p, poll_us);
             }
         }
-        
-        running = false;
-        {
-            lock_guard<mutex> lock(camera_mutex);
-            frame_available.notify_all();
-            queue_not_full.notify_all();
+        outbox.clear();
+        if (opt.display) {
+            TraceScope trace("waitKey");
+            int key = waitKey(1);
+            if (key == 27 || key == 'q' || key == 'Q') break;
         }
         
-        if (camera_thread.joinable()) {
-            camera_thread.join();
+        auto now = high_resolution_clock::now();
+        double elapsed = duration_cast<duration<double>>(now - last_log_time).count();
+        if (elapsed >= 5.0) {
+            for (auto& s : streams) {
+                print_stats(s->stats, elapsed, s->label);
+                print_sender_stats(s->sender, elapsed, opt.sender.budget_bytes_per_sec);
+            }
+            if (publisher) {
+                print_mqtt_stats(publisher->stats(), elapsed);
+                publisher->reset_stats();
+            }
+            if (udp) {
+                print_udp_send_stats(udp->stats(), elapsed);
+                udp->reset_stats();
+            }
+            print_pool_stats(pool);
+            last_log_time = now;
         }
+        tracer_poll();
         
-        destroyAllWindows();
-        cout << "Multi-thread mode completed. Total frames: " << stats.total_frames << endl;
+        // 3. 所有流都已读完、队列为空且无在途帧时结束
+        bool finished = true;
+        for (auto& s : streams) {
+            if (!s->eof || !s->queue.empty() || s->busy) finished = false;
+        }
+        if (finished) {
+            lock_guard<mutex> lock(pipeline_mutex);
+            if (results.empty()) break;
+        }
         
-    } else {
-        run_single_thread_mode(source);
+        // 4. 等待新事件；不节拍时无事件也最多等5ms以便按时派发
+        TraceScope trace("idle");
+        unique_lock<mutex> lock(pipeline_mutex);
+        frame_available.wait_for(lock, milliseconds(5), [&seen_events]{
+            return pipeline_events != seen_events;
+        });
+    }
+    
+    running = false;
+    for (auto& s : streams) {
+        {
+            lock_guard<mutex> lock(s->mutex);
+        }
+        s->queue_not_full.notify_all();
+    }
+    for (auto& s : streams) {
+        if (s->capture_thread.joinable()) s->capture_thread.join();
+        if (s->inflight.valid()) pool.wait(s->inflight);
+        if (s->recorder) s->recorder->close();
     }
     
+    if (packet_log.is_open()) {
+        cout << "Packet log: " << packet_log.records() << " packets, " << packet_log.bytes() / 1024
+             << " KB -> " << opt.packet_log << endl;
+        packet_log.close();
+    }
+    tracer_close();
+    
+    if (opt.display) destroyAllWindows();
+    for (auto& s : streams) {
+        cout << s->label << " (" << s->source << ") completed. Total frames: "
+             << s->stats.total_frames << endl;
+    }
     return 0;
-}
\ No newline at end of file
+}
+
+// ============ 主函数 ============
+int main(int argc, char* argv[]) {
+    PipelineOptions opt;
+    bool record_set = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--fast") {
+            opt.fast = true;
+        } else if (arg == "--headless") {
+            opt.display = false;
+        } else if (arg == "--record") {
+            opt.record = true;
+            record_set = true;
+        } else if (arg == "--no-record") {
+            opt.record = false;
+            record_set = true;
+        } else if (arg == "--prefetch" && i + 1 < argc) {
+            opt.prefetch_depth = atoi(argv[++i]);
+        } else if (arg == "--skip" && i + 1 < argc) {
+            frame_skip = max(1, atoi(argv[++i]));
+        } else if (arg == "--source" && i + 1 < argc) {
+            opt.sources.push_back(argv[++i]);
+        } else if (arg == "--map-rate" && i + 1 < argc) {
+            opt.sender.map_rate_hz = atof(argv[++i]);
+        } else if (arg == "--ball-rate" && i + 1 < argc) {
+            opt.sender.ball_rate_hz = atof(argv[++i]);
+        } else if (arg == "--budget" && i + 1 < argc) {
+            opt.sender.budget_bytes_per_sec = atol(argv[++i]);
+        } else if (arg == "--fec" && i + 1 < argc) {
+            opt.sender.fec_group = min(max(atoi(argv[++i]), 0), MAX_FEC_GROUP);
+        } else if (arg == "--resync-rows" && i + 1 < argc) {
+            opt.resync_rows = max(0, atoi(argv[++i]));
+        } else if (arg == "--mqtt" && i + 1 < argc) {
+            opt.mqtt_broker = argv[++i];
+            MqttConfig mc;
+            if (!parse_broker(opt.mqtt_broker, mc)) {
+                cerr << "Invalid broker address: " << opt.mqtt_broker << endl;
+                return 1;
+            }
+        } else if (arg == "--topic" && i + 1 < argc) {
+            opt.mqtt_topic = argv[++i];
+        } else if (arg == "--udp" && i + 1 < argc) {
+            opt.udp_target = argv[++i];
+        } else if (arg == "--log-packets" && i + 1 < argc) {
+            opt.packet_log = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            opt.trace_path = argv[++i];
+        } else {
+            cerr << "Unknown option: " << arg << endl;
+            cerr << "Usage: " << argv[0]
+                 << " [--source CAM_INDEX|FILE|shm:NAME]... [--fast] [--headless] [--record|--no-record]"
+                    " [--prefetch N] [--skip N] [--map-rate HZ] [--ball-rate HZ] [--budget BYTES_PER_SEC]"
+                    " [--fec N] [--resync-rows N (0 = off, " << DEFAULT_RESYNC_ROWS << " recommended)]"
+                    " [--mqtt HOST[:PORT]] [--topic PREFIX] [--udp HOST[:PORT]] [--log-packets FILE.hpl]"
+                    " [--trace FILE.json]"
+                 << endl;
+            return 1;
+        }
+    }
+    
+    if (opt.sources.empty()) {
+        cout << "=== Image Source Selection ===" << endl;
+        cout << "1. Camera (press 1)" << endl;
+        cout << "2. Video File (press 2)" << endl;
+        cout << "Please select (1 or 2): ";
+        
+        char choice;
+        cin >> choice;
+        
+        if (choice == '1') {
+            opt.sources.push_back("0");
+            cout << "Using camera as source..." << endl;
+        } else {
+            opt.sources.push_back("../vid/test_video3.avi");  // 默认视频文件路径
+            if (!record_set) opt.record = true;                // 视频文件默认录制输出
+            cout << "Using video file: " << opt.sources.back() << endl;
+        }
+        cout << endl;
+    }
+    
+    // 全程序共享的任务线程池（各路帧处理、压缩分支并行、异步录制）
+    ThreadPool pool;
+    
+    return run_pipeline(opt, pool) == 0 ? 0 : 1;
+}
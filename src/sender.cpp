@@ -0,0 +1,216 @@
+#include "sender.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+constexpr int MAX_MATCH_DIST = 12;           // 相邻两帧同一弹丸的最大位移（小分辨率像素）
+constexpr int MAX_EXTRAPOLATE_FRAMES = 2;    // 外推最多跨越的帧间隔数，防止丢帧时越推越远
+
+bool classify_packet(const uint8_t* data, int len, OutPacket& pkt) {
+    if (len == (int)sizeof(MqttPacket)) {
+        pkt.type = OutPacket::MAP;
+        pkt.stream_id = (data[1] & CFG_STREAM_MASK) >> CFG_STREAM_SHIFT;
+    } else if (len == (int)sizeof(BallPacket) && data[0] == BALL_PACKET_MAGIC) {
+        pkt.type = OutPacket::BALL;
+        pkt.stream_id = (data[1] & CFG_STREAM_MASK) >> CFG_STREAM_SHIFT;
+    } else if (len == (int)sizeof(ParityPacket) && data[0] == PARITY_PACKET_MAGIC) {
+        pkt.type = OutPacket::PARITY;
+        pkt.stream_id = (data[1] & CFG_STREAM_MASK) >> CFG_STREAM_SHIFT;
+    } else {
+        return false;
+    }
+    pkt.len = len;
+    memcpy(pkt.data, data, len);
+    return true;
+}
+
+// ============ TokenBucket 成员函数实现 ============
+TokenBucket::TokenBucket(long rate_bytes_per_sec, long burst_bytes)
+    : rate_((double)max(0L, rate_bytes_per_sec)),
+      burst_((double)max(burst_bytes, (long)MAX_PACKET_BYTE)),
+      tokens_(burst_) {}
+
+void TokenBucket::refill(int64_t now_us) {
+    if (last_us_ == 0 || now_us < last_us_) last_us_ = now_us;
+    tokens_ = min(burst_, tokens_ + (now_us - last_us_) * rate_ / 1e6);
+    last_us_ = now_us;
+}
+
+bool TokenBucket::available(int bytes, int64_t now_us) {
+    if (!enabled()) return true;
+    refill(now_us);
+    return tokens_ >= bytes;
+}
+
+bool TokenBucket::consume(int bytes, int64_t now_us) {
+    if (!available(bytes, now_us)) return false;
+    if (enabled()) tokens_ -= bytes;
+    return true;
+}
+
+// ============ DualRateSender 成员函数实现 ============
+DualRateSender::DualRateSender(const SenderConfig& cfg)
+    : cfg_(cfg), own_bucket_(cfg.budget_bytes_per_sec, max(cfg.burst_bytes, MIN_BURST_BYTES)), fec_(cfg.fec_group) {
+    map_interval_us_ = cfg_.map_rate_hz > 0 ? (int64_t)(1e6 / cfg_.map_rate_hz) : 0;
+    ball_interval_us_ = cfg_.ball_rate_hz > 0 ? (int64_t)(1e6 / cfg_.ball_rate_hz) : 0;
+    memset(balls_, 0, sizeof(balls_));
+    memset(prev_balls_, 0, sizeof(prev_balls_));
+}
+
+void DualRateSender::on_frame(const ProcessResult& result, int64_t now_us, vector<OutPacket>& out) {
+    stream_id_ = result.meta.stream_id;
+
+    // 更新弹丸观测
+    memcpy(prev_balls_, balls_, sizeof(balls_));
+    prev_count_ = ball_count_;
+    prev_capture_us_ = capture_us_;
+    ball_count_ = 0;
+    for (int i = 0; i < 4; i++) {
+        const BallInfo& b = result.packet.balls[i];
+        if (b.x != 0 || b.y != 0) balls_[ball_count_++] = b;
+    }
+    for (int i = ball_count_; i < 4; i++) balls_[i] = BallInfo{0, 0, 0};
+    capture_us_ = result.meta.capture_us ? result.meta.capture_us : now_us;
+    update_velocity();
+
+    TokenBucket* tb = bucket();
+    bool map_due = map_interval_us_ > 0 && now_us >= next_map_us_;
+    bool map_deferred = false;
+
+    // 地图包：到期且令牌在发完后还够下一个弹丸包时才发，保证弹丸包不被地图包饿死；
+    // 这个地图包凑满一组时还要连同校验包一起算，否则校验包总会因令牌不足被放弃
+    if (map_due) {
+        int need = TOTAL_PACKET_BYTE + BALL_PACKET_BYTE;
+        if (fec_.completes_group((uint8_t)(map_seq_ + 1))) need += PARITY_PACKET_BYTE;
+        if (!tb || (tb->available(need, now_us) &&
+                    tb->consume(TOTAL_PACKET_BYTE, now_us))) {
+            OutPacket p;
+            p.type = OutPacket::MAP;
+            p.stream_id = stream_id_;
+            p.len = sizeof(MqttPacket);
+            MqttPacket pkt = result.packet;
+            pkt.frame_seq = ++map_seq_;  // 地图包独立编号
+            packet_seal(pkt);
+            memcpy(p.data, &pkt, sizeof(MqttPacket));
+            out.push_back(p);
+            stats_.map_packets++;
+            stats_.bytes += p.len;
+            emit_parity(pkt, now_us, out);
+
+            next_map_us_ += map_interval_us_;
+            if (next_map_us_ < now_us) next_map_us_ = now_us + map_interval_us_;
+            // 地图包已带本帧弹丸位置
+            next_ball_us_ = now_us + ball_interval_us_;
+            return;
+        }
+        // 保持到期状态，下一帧用更新的数据再试
+        map_deferred = true;
+        stats_.deferred_maps++;
+    }
+
+    // 弹丸包：未指定频率时每帧发送，否则到期才发送；地图包被推迟时总是补一个弹丸包
+    if (map_deferred || ball_interval_us_ == 0 || now_us >= next_ball_us_) {
+        if (!tb || tb->consume(BALL_PACKET_BYTE, now_us)) {
+            emit_ball(now_us, false, out);
+        } else {
+            stats_.skipped_frames++;
+        }
+    }
+}
+
+void DualRateSender::poll(int64_t now_us, vector<OutPacket>& out) {
+    if (ball_interval_us_ == 0 || capture_us_ == 0 || now_us < next_ball_us_) return;
+    TokenBucket* tb = bucket();
+    if (tb && !tb->consume(BALL_PACKET_BYTE, now_us)) {
+        // 令牌不足时放弃这次插值，不积压
+        next_ball_us_ = now_us + ball_interval_us_;
+        return;
+    }
+    emit_ball(now_us, true, out);
+}
+
+void DualRateSender::emit_parity(const MqttPacket& pkt, int64_t now_us, vector<OutPacket>& out) {
+    ParityPacket pp;
+    if (!fec_.add(pkt, stream_id_, pp)) return;
+    // 校验包只是保险，令牌不足时放弃，不挤占下一帧的地图包与弹丸包
+    TokenBucket* tb = bucket();
+    if (tb && !tb->consume(PARITY_PACKET_BYTE, now_us)) {
+        stats_.parity_skipped++;
+        return;
+    }
+    OutPacket p;
+    p.type = OutPacket::PARITY;
+    p.stream_id = stream_id_;
+    p.len = sizeof(ParityPacket);
+    memcpy(p.data, &pp, sizeof(ParityPacket));
+    out.push_back(p);
+    stats_.parity_packets++;
+    stats_.bytes += p.len;
+}
+
+void DualRateSender::update_velocity() {
+    int64_t frame_dt = capture_us_ - prev_capture_us_;
+    for (int i = 0; i < 4; i++) vel_x_[i] = vel_y_[i] = 0;
+    if (prev_capture_us_ <= 0 || frame_dt <= 0) return;
+    for (int i = 0; i < ball_count_; i++) {
+        // 取上一帧中最近的弹丸作为同一目标估计速度，找不到则视为静止
+        int best = -1, best_d = MAX_MATCH_DIST * MAX_MATCH_DIST + 1;
+        for (int j = 0; j < prev_count_; j++) {
+            int dx = balls_[i].x - prev_balls_[j].x;
+            int dy = balls_[i].y - prev_balls_[j].y;
+            if (dx * dx + dy * dy < best_d) {
+                best_d = dx * dx + dy * dy;
+                best = j;
+            }
+        }
+        if (best < 0) continue;
+        vel_x_[i] = (balls_[i].x - prev_balls_[best].x) * 1e6 / frame_dt;
+        vel_y_[i] = (balls_[i].y - prev_balls_[best].y) * 1e6 / frame_dt;
+    }
+}
+
+void DualRateSender::emit_ball(int64_t now_us, bool predicted, vector<OutPacket>& out) {
+    BallPacket bp;
+    memset(&bp, 0, sizeof(bp));
+    bp.magic = BALL_PACKET_MAGIC;
+    bp.config = (uint8_t)((stream_id_ << CFG_STREAM_SHIFT) & CFG_STREAM_MASK);
+    bp.seq = ++ball_seq_;
+    bp.map_seq = map_seq_;
+    bp.count = (uint8_t)ball_count_;
+    bp.capture_us = (uint32_t)capture_us_;
+    memcpy(bp.balls, balls_, sizeof(balls_));
+
+    for (int i = 0; i < ball_count_; i++) {
+        bp.vel[i].vx = (int8_t)min(max((int)lround(vel_x_[i] / BALL_VEL_UNIT), -127), 127);
+        bp.vel[i].vy = (int8_t)min(max((int)lround(vel_y_[i] / BALL_VEL_UNIT), -127), 127);
+    }
+
+    int64_t frame_dt = capture_us_ - prev_capture_us_;
+    if (predicted && prev_capture_us_ > 0 && frame_dt > 0) {
+        bp.config |= BALL_CFG_PREDICTED;
+        int64_t dt_us = min(now_us - capture_us_, frame_dt * MAX_EXTRAPOLATE_FRAMES);
+        double t = (double)dt_us / 1e6;
+        // 时间戳与位置对应：外推到的时刻，而不是发送时刻（外推有上限，两者可能不同）
+        bp.capture_us = (uint32_t)(capture_us_ + dt_us);
+        for (int i = 0; i < ball_count_; i++) {
+            double x = balls_[i].x + vel_x_[i] * t;
+            double y = balls_[i].y + vel_y_[i] * t;
+            bp.balls[i].x = (uint8_t)min(max((int)lround(x), 1), TARGET_SIZE.width - 1);
+            bp.balls[i].y = (uint8_t)min(max((int)lround(y), 1), TARGET_SIZE.height - 1);
+        }
+    }
+
+    OutPacket p;
+    p.type = OutPacket::BALL;
+    p.stream_id = stream_id_;
+    p.len = sizeof(BallPacket);
+    memcpy(p.data, &bp, sizeof(BallPacket));
+    out.push_back(p);
+    stats_.ball_packets++;
+    if (bp.config & BALL_CFG_PREDICTED) stats_.predicted_packets++;
+    stats_.bytes += p.len;
+
+    next_ball_us_ = now_us + ball_interval_us_;
+}
@@ -0,0 +1,262 @@
+#include "shm_frame.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace cv;
+using namespace std;
+
+static size_t align64(size_t n) { return (n + 63) & ~size_t(63); }
+
+static size_t slot_stride(uint32_t slot_bytes) {
+    return sizeof(ShmSlotHeader) + align64(slot_bytes);
+}
+
+static ShmRingHeader* ring_header(void* base) {
+    return reinterpret_cast<ShmRingHeader*>(base);
+}
+
+// ============ ShmFrameWriter 成员函数实现 ============
+ShmFrameWriter::~ShmFrameWriter() { close(); }
+
+bool ShmFrameWriter::open(const string& name, int slot_count, size_t slot_bytes) {
+    close();
+    name_ = "/" + name;
+
+    // slot数取2的幂，读端可以只凭帧序号低32位定位slot
+    uint32_t count = 1;
+    while (count < (uint32_t)max(slot_count, 2)) count <<= 1;
+    uint32_t bytes = (uint32_t)align64(slot_bytes);
+    size_t need = sizeof(ShmRingHeader) + count * slot_stride(bytes);
+
+    int fd = shm_open(name_.c_str(), O_CREAT | O_RDWR, 0666);
+    if (fd < 0) {
+        cerr << "[错误] shm_open失败: " << name_ << ": " << strerror(errno) << endl;
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+
+    // 已存在但布局不同：删除重建，读端通过inode变化发现并重新挂载
+    bool reuse = false;
+    if ((size_t)st.st_size >= sizeof(ShmRingHeader)) {
+        ShmRingHeader old;
+        if (pread(fd, &old, sizeof(old), 0) == (ssize_t)sizeof(old)) {
+            reuse = old.magic == SHM_MAGIC && old.version == SHM_VERSION &&
+                    old.slot_count == count && old.slot_bytes == bytes &&
+                    (size_t)st.st_size == need;
+        }
+        if (!reuse) {
+            ::close(fd);
+            shm_unlink(name_.c_str());
+            fd = shm_open(name_.c_str(), O_CREAT | O_RDWR, 0666);
+            if (fd < 0) return false;
+        }
+    }
+    if (!reuse && ftruncate(fd, need) != 0) {
+        cerr << "[错误] ftruncate失败: " << strerror(errno) << endl;
+        ::close(fd);
+        return false;
+    }
+
+    base_ = mmap(nullptr, need, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base_ == MAP_FAILED) {
+        base_ = nullptr;
+        return false;
+    }
+    map_size_ = need;
+
+    ShmRingHeader* hdr = ring_header(base_);
+    uint8_t* slots = reinterpret_cast<uint8_t*>(base_) + sizeof(ShmRingHeader);
+    for (uint32_t i = 0; i < count; i++) {
+        reinterpret_cast<ShmSlotHeader*>(slots + i * slot_stride(bytes))->seq.store(0);
+    }
+    if (reuse) {
+        hdr->generation.fetch_add(1);
+        hdr->write_seq.store(0, memory_order_release);
+    } else {
+        hdr->slot_count = count;
+        hdr->slot_bytes = bytes;
+        hdr->version = SHM_VERSION;
+        hdr->generation.store(1);
+        hdr->write_seq.store(0);
+        atomic_thread_fence(memory_order_release);
+        hdr->magic = SHM_MAGIC;
+    }
+    seq_ = 0;
+    return true;
+}
+
+bool ShmFrameWriter::write(const Mat& frame, int64_t timestamp_us) {
+    if (!base_ || frame.empty() || frame.type() != CV_8UC3) return false;
+    ShmRingHeader* hdr = ring_header(base_);
+    size_t row_bytes = frame.cols * frame.elemSize();
+    size_t size = row_bytes * frame.rows;
+    if (size > hdr->slot_bytes) return false;
+
+    uint64_t n = ++seq_;
+    uint8_t* slot_base = reinterpret_cast<uint8_t*>(base_) + sizeof(ShmRingHeader) +
+                         (n % hdr->slot_count) * slot_stride(hdr->slot_bytes);
+    ShmSlotHeader* s = reinterpret_cast<ShmSlotHeader*>(slot_base);
+    uint8_t* data = slot_base + sizeof(ShmSlotHeader);
+
+    s->seq.store(0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    s->timestamp_us = timestamp_us;
+    s->width = frame.cols;
+    s->height = frame.rows;
+    s->stride = (uint32_t)row_bytes;
+    s->type = frame.type();
+    s->size = (uint32_t)size;
+    for (int r = 0; r < frame.rows; r++) {
+        memcpy(data + r * row_bytes, frame.ptr(r), row_bytes);
+    }
+    s->seq.store(n, memory_order_release);
+    hdr->write_seq.store(n, memory_order_release);
+    return true;
+}
+
+void ShmFrameWriter::close() {
+    if (base_) munmap(base_, map_size_);
+    base_ = nullptr;
+    map_size_ = 0;
+}
+
+// ============ ShmFrameReader 成员函数实现 ============
+ShmFrameReader::~ShmFrameReader() {
+    detach();
+}
+
+bool ShmFrameReader::attach(const string& name) {
+    // 旧映射上可能还有在途帧，由帧的keepalive持有，最后一帧丢弃时解除映射
+    detach();
+    name_ = (!name.empty() && name[0] == '/') ? name : "/" + name;
+
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmRingHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) return false;
+
+    ShmRingHeader* hdr = ring_header(base);
+    size_t need = sizeof(ShmRingHeader) + (size_t)hdr->slot_count * slot_stride(hdr->slot_bytes);
+    if (hdr->magic != SHM_MAGIC || hdr->version != SHM_VERSION ||
+        hdr->slot_count == 0 || need > (size_t)st.st_size) {
+        munmap(base, st.st_size);
+        return false;
+    }
+
+    size_t size = st.st_size;
+    mapping_ = shared_ptr<const void>(base, [size](const void* p) { munmap(const_cast<void*>(p), size); });
+    base_ = base;
+    map_size_ = size;
+    inode_ = st.st_ino;
+    generation_ = hdr->generation.load();
+    last_seq_ = 0;
+    last_frame_us_ = monotonic_us();
+    return true;
+}
+
+void ShmFrameReader::detach() {
+    mapping_.reset();
+    base_ = nullptr;
+    map_size_ = 0;
+}
+
+ShmSlotHeader* ShmFrameReader::slot(uint64_t seq) const {
+    ShmRingHeader* hdr = ring_header(base_);
+    uint8_t* p = reinterpret_cast<uint8_t*>(base_) + sizeof(ShmRingHeader) +
+                 (seq % hdr->slot_count) * slot_stride(hdr->slot_bytes);
+    return reinterpret_cast<ShmSlotHeader*>(p);
+}
+
+bool ShmFrameReader::reattach_if_replaced() {
+    struct stat st;
+    int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    bool replaced = fstat(fd, &st) == 0 &&
+                    ((unsigned long)st.st_ino != inode_ || (size_t)st.st_size != map_size_);
+    ::close(fd);
+    if (!replaced) return false;
+    cout << "[shm] " << name_ << " recreated by writer, reattaching" << endl;
+    string name = name_;
+    return attach(name);
+}
+
+bool ShmFrameReader::next(FrameEnvelope& frame, int timeout_ms) {
+    int64_t deadline = monotonic_us() + (int64_t)timeout_ms * 1000;
+    while (true) {
+        if (base_) {
+            ShmRingHeader* hdr = ring_header(base_);
+            uint64_t gen = hdr->generation.load(memory_order_acquire);
+            if (gen != generation_) {
+                // 写端重启：序号从头开始
+                generation_ = gen;
+                last_seq_ = 0;
+            }
+
+            uint64_t latest = hdr->write_seq.load(memory_order_acquire);
+            if (latest > last_seq_) {
+                ShmSlotHeader* s = slot(latest);
+                if (s->seq.load(memory_order_acquire) == latest) {
+                    uint8_t* data = reinterpret_cast<uint8_t*>(s) + sizeof(ShmSlotHeader);
+                    // slot头由另一进程写入，先校验再包装，避免越界读取或OpenCV断言
+                    uint32_t width = s->width, height = s->height, stride = s->stride;
+                    int32_t type = s->type;
+                    if (type != CV_8UC3 || width == 0 || height == 0 || width > (uint32_t)INT32_MAX / 3 ||
+                        stride < width * 3 || (uint64_t)stride * height > hdr->slot_bytes) {
+                        if (!warned_bad_slot_) {
+                            cerr << "[shm] " << name_ << " slot header invalid (" << width << "x" << height
+                                 << ", type " << type << ", stride " << stride << "), skipping frames" << endl;
+                            warned_bad_slot_ = true;
+                        }
+                        last_seq_ = latest;
+                        continue;
+                    }
+                    // 只读映射：process()只读取输入，不会写入
+                    frame.image = Mat((int)height, (int)width, type, data, stride);
+                    frame.keepalive = mapping_;
+                    frame.meta = FrameMeta();
+                    frame.meta.capture_us = s->timestamp_us;
+                    frame.meta.retrieve_us = monotonic_us();
+                    frame.meta.source_seq = (uint32_t)latest;
+                    frame.meta.skipped = last_seq_ ? (uint32_t)(latest - last_seq_ - 1) : 0;
+                    last_seq_ = latest;
+                    last_frame_us_ = frame.meta.retrieve_us;
+                    if (s->seq.load(memory_order_acquire) == latest) return true;
+                }
+            }
+        }
+
+        int64_t now = monotonic_us();
+        if (now - last_frame_us_ > SHM_REATTACH_MS * 1000L) {
+            string name = name_;
+            if (base_ ? reattach_if_replaced() : attach(name)) continue;
+            last_frame_us_ = now;
+        }
+        if (now >= deadline) return false;
+        // 轮询间隔1ms，相对33ms帧间隔可以忽略
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+bool ShmFrameReader::still_valid(const FrameEnvelope& frame) const {
+    if (!frame.image.data) return false;
+    // slot头紧挨在像素数据之前；映射由frame.keepalive持有，这里可以安全访问
+    atomic_thread_fence(memory_order_acquire);
+    const ShmSlotHeader* s = reinterpret_cast<const ShmSlotHeader*>(
+        frame.image.data - sizeof(ShmSlotHeader));
+    return (uint32_t)s->seq.load(memory_order_relaxed) == frame.meta.source_seq;
+}
@@ -0,0 +1,81 @@
+#include "shm_frame.h"
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+using namespace cv;
+using namespace std;
+using namespace std::chrono;
+
+// ============ 共享内存写端测试工具 ============
+// 模拟自瞄主进程：从视频文件或摄像头读帧，按源帧率写入共享内存环形缓冲区
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " NAME SOURCE [--slots N] [--loop] [--fps F]" << endl;
+        return 1;
+    }
+    string name = argv[1];
+    string source = argv[2];
+    int slots = 8;
+    bool loop = false;
+    double fps = 0;
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--slots" && i + 1 < argc) {
+            slots = atoi(argv[++i]);
+        } else if (arg == "--loop") {
+            loop = true;
+        } else if (arg == "--fps" && i + 1 < argc) {
+            fps = atof(argv[++i]);
+        }
+    }
+
+    VideoCapture cap;
+    bool is_camera = source.find_first_not_of("0123456789") == string::npos;
+    if (is_camera) cap.open(atoi(source.c_str()));
+    else cap.open(source);
+    if (!cap.isOpened()) {
+        cerr << "Error: Could not open source: " << source << endl;
+        return 1;
+    }
+    if (fps <= 0) fps = cap.get(CAP_PROP_FPS);
+    if (fps <= 0) fps = 30.0;
+
+    Mat frame;
+    ShmFrameWriter writer;
+    bool opened = false;
+    long written = 0;
+    auto interval = microseconds((long)(1e6 / fps));
+    auto next_due = steady_clock::now();
+
+    while (true) {
+        if (!cap.read(frame) || frame.empty()) {
+            if (loop && !is_camera) {
+                cap.set(CAP_PROP_POS_FRAMES, 0);
+                continue;
+            }
+            break;
+        }
+        // 按第一帧的尺寸确定slot容量
+        if (!opened) {
+            if (!writer.open(name, slots, frame.total() * frame.elemSize())) return 1;
+            opened = true;
+            cout << "Writing " << frame.cols << "x" << frame.rows << " @ " << fps
+                 << " fps to /" << name << " (" << slots << " slots)" << endl;
+        }
+        if (!writer.write(frame, monotonic_us())) {
+            cerr << "Frame " << written << " rejected (size/type changed?)" << endl;
+            continue;
+        }
+        written++;
+        if (written % 300 == 0) cout << "Written: " << written << endl;
+
+        if (!is_camera) {
+            next_due += interval;
+            this_thread::sleep_until(next_due);
+        }
+    }
+    cout << "Done. Frames written: " << written << endl;
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "stage_timer.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+static const char* const STAGE_NAMES[STAGE_COUNT] = {
+    "gray", "blur", "canny", "contours", "hsv", "ball filter", "resize", "encode",
+    "capture", "queue wait", "process", "display", "record",
+};
+
+const char* stage_name(int stage) {
+    return stage >= 0 && stage < STAGE_COUNT ? STAGE_NAMES[stage] : "?";
+}
+
+// ============ LatencyHistogram 成员函数实现 ============
+static int bucket_of(uint32_t v) {
+    if (v < (uint32_t)HIST_SUB_BUCKETS) return (int)v;
+    int msb = 31 - __builtin_clz(v);
+    uint32_t top = v >> (msb - HIST_SUB_BITS);  // 落在[SUB, 2*SUB)
+    return (msb - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS + (int)(top - HIST_SUB_BUCKETS);
+}
+
+static int64_t bucket_upper(int idx) {
+    if (idx < HIST_SUB_BUCKETS) return idx;
+    int e = idx / HIST_SUB_BUCKETS;
+    int64_t top = HIST_SUB_BUCKETS + idx % HIST_SUB_BUCKETS;
+    return ((top + 1) << (e - 1)) - 1;
+}
+
+void LatencyHistogram::record(int64_t us) {
+    if (us < 0) us = 0;
+    if (us > 0xFFFFFFFFLL) us = 0xFFFFFFFFLL;
+    counts_[bucket_of((uint32_t)us)]++;
+    count_++;
+    sum_ += us;
+    if (us > max_) max_ = us;
+}
+
+int64_t LatencyHistogram::percentile(double p) const {
+    if (count_ == 0) return 0;
+    // 第rank个样本（从1计）所在的桶
+    long rank = (long)(p / 100.0 * count_ + 0.5);
+    rank = std::min(std::max(rank, 1L), count_);
+    long seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += counts_[i];
+        if (seen >= rank) return std::min(bucket_upper(i), max_);
+    }
+    return max_;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (int i = 0; i < HIST_BUCKETS; i++) counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+}
+
+void LatencyHistogram::reset() {
+    memset(counts_, 0, sizeof(counts_));
+    count_ = 0;
+    sum_ = 0;
+    max_ = 0;
+}
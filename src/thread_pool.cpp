@@ -0,0 +1,177 @@
+#include "thread_pool.h"
+#include "tracer.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+
+using namespace std;
+using namespace std::chrono;
+
+// 当前线程所属的线程池及其工作线程序号（非工作线程为-1）
+static thread_local ThreadPool* tls_pool = nullptr;
+static thread_local int tls_worker = -1;
+
+// ============ 构造/析构 ============
+ThreadPool::ThreadPool(int num_threads, bool pin_threads) {
+    int hw = static_cast<int>(thread::hardware_concurrency());
+    if (hw <= 0) hw = 1;
+    if (num_threads <= 0) num_threads = hw - 1;
+    num_threads = max(1, min(num_threads, min(hw, MAX_THREADS)));
+
+    stats_start_ = steady_clock::now();
+    for (int i = 0; i < num_threads; i++) {
+        workers_.emplace_back(new Worker());
+    }
+    for (int i = 0; i < num_threads; i++) {
+        workers_[i]->thread = thread(&ThreadPool::worker_loop, this, i);
+        if (pin_threads) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % hw, &cpus);
+            pthread_setaffinity_np(workers_[i]->thread.native_handle(), sizeof(cpus), &cpus);
+        }
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    sleep_cv_.notify_all();
+    for (auto& w : workers_) {
+        if (w->thread.joinable()) w->thread.join();
+    }
+}
+
+// ============ 任务队列 ============
+void ThreadPool::push_task(function<void()> task, int affinity) {
+    int n = size();
+    int target;
+    if (affinity >= 0) {
+        target = affinity % n;
+    } else if (tls_pool == this && tls_worker >= 0) {
+        target = tls_worker;  // 工作线程提交的子任务放回自己的队列，缓存更热
+    } else {
+        target = static_cast<int>(next_worker_++ % n);
+    }
+    {
+        lock_guard<mutex> lock(workers_[target]->mutex);
+        workers_[target]->tasks.push_back(std::move(task));
+    }
+    tasks_submitted_++;
+    pending_++;
+    {
+        lock_guard<mutex> lock(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+}
+
+bool ThreadPool::pop_task(int self, function<void()>& task, bool& stolen) {
+    int n = size();
+    if (self >= 0) {
+        Worker& w = *workers_[self];
+        lock_guard<mutex> lock(w.mutex);
+        if (!w.tasks.empty()) {
+            task = std::move(w.tasks.back());
+            w.tasks.pop_back();
+            pending_--;
+            stolen = false;
+            return true;
+        }
+    }
+    // 从其他队列头部窃取（最早提交的任务）
+    int start = (self >= 0) ? self + 1 : static_cast<int>(next_worker_.load() % n);
+    for (int k = 0; k < n; k++) {
+        int victim = (start + k) % n;
+        if (victim == self) continue;
+        Worker& w = *workers_[victim];
+        lock_guard<mutex> lock(w.mutex);
+        if (!w.tasks.empty()) {
+            task = std::move(w.tasks.front());
+            w.tasks.pop_front();
+            pending_--;
+            stolen = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::execute(int self, function<void()>& task, bool stolen) {
+    auto t0 = steady_clock::now();
+    task();
+    if (self < 0) return;  // 外部线程帮忙执行的任务不计入工作线程利用率
+    Worker& w = *workers_[self];
+    w.busy_us += duration_cast<microseconds>(steady_clock::now() - t0).count();
+    w.tasks_run++;
+    if (stolen) w.tasks_stolen++;
+}
+
+bool ThreadPool::run_one() {
+    int self = (tls_pool == this) ? tls_worker : -1;
+    function<void()> task;
+    bool stolen = false;
+    if (!pop_task(self, task, stolen)) return false;
+    execute(self, task, stolen);
+    return true;
+}
+
+void ThreadPool::worker_loop(int index) {
+    tls_pool = this;
+    tls_worker = index;
+    tracer_set_thread_name("worker " + to_string(index));
+    while (true) {
+        function<void()> task;
+        bool stolen = false;
+        if (pop_task(index, task, stolen)) {
+            execute(index, task, stolen);
+            continue;
+        }
+        unique_lock<mutex> lock(sleep_mutex_);
+        sleep_cv_.wait(lock, [this] { return stop_ || pending_ > 0; });
+        if (stop_ && pending_ == 0) return;
+    }
+}
+
+// ============ 统计 ============
+PoolStats ThreadPool::stats() const {
+    PoolStats s;
+    s.threads = size();
+    s.tasks_submitted = tasks_submitted_;
+    double wall_us = static_cast<double>(
+        duration_cast<microseconds>(steady_clock::now() - stats_start_).count());
+    long total_busy = 0;
+    for (const auto& w : workers_) {
+        s.tasks_run += w->tasks_run;
+        s.tasks_stolen += w->tasks_stolen;
+        total_busy += w->busy_us;
+        s.worker_utilisation.push_back(wall_us > 0 ? w->busy_us / wall_us : 0.0);
+    }
+    if (wall_us > 0 && s.threads > 0) s.utilisation = total_busy / (wall_us * s.threads);
+    return s;
+}
+
+void ThreadPool::reset_stats() {
+    for (auto& w : workers_) {
+        w->tasks_run = 0;
+        w->tasks_stolen = 0;
+        w->busy_us = 0;
+    }
+    tasks_submitted_ = 0;
+    stats_start_ = steady_clock::now();
+}
+
+// ============ 线程池统计输出 ============
+void print_pool_stats(const ThreadPool& pool) {
+    PoolStats ps = pool.stats();
+    cout << "Pool: " << ps.threads << " threads, util " << fixed << setprecision(1)
+         << ps.utilisation * 100.0 << "% [";
+    for (size_t i = 0; i < ps.worker_utilisation.size(); i++) {
+        if (i) cout << " ";
+        cout << setprecision(0) << ps.worker_utilisation[i] * 100.0 << "%";
+    }
+    cout << "], tasks " << ps.tasks_run << " (stolen " << ps.tasks_stolen << ")" << endl;
+}
@@ -0,0 +1,220 @@
+#include "tracer.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+
+using namespace std;
+
+std::atomic<bool> g_trace_enabled{false};
+
+namespace {
+
+struct TraceEvent {
+    int64_t ts_us;
+    const char* name;
+    int64_t value;
+    int32_t id;
+    char ph;
+};
+
+// 单生产者（所属线程）单消费者（导出线程）环形缓冲区
+struct TraceBuffer {
+    int tid = 0;
+    string thread_name;              // 受registry_mutex保护
+    bool name_written = false;
+    atomic<uint64_t> head{0};        // 生产者写
+    atomic<uint64_t> tail{0};        // 消费者写
+    atomic<long> dropped{0};
+    uint64_t reserved = 0;           // 已记开始事件、结束事件尚未写入的作用域数（只由生产者访问）
+    TraceEvent events[TRACE_BUFFER_EVENTS];
+};
+
+mutex registry_mutex;                // 保护buffers、输出文件与线程名
+vector<unique_ptr<TraceBuffer>> buffers;  // 线程退出后缓冲区仍保留，直到进程结束
+FILE* out = nullptr;
+string out_path;
+bool first_event = true;
+long written = 0;
+int pid = 0;
+volatile sig_atomic_t flush_requested = 0;
+
+thread_local TraceBuffer* tls_buffer = nullptr;
+thread_local string tls_thread_name;
+
+void on_flush_signal(int) { flush_requested = 1; }
+
+TraceBuffer* register_thread() {
+    unique_ptr<TraceBuffer> buf(new TraceBuffer());
+    lock_guard<mutex> lock(registry_mutex);
+    buf->tid = (int)buffers.size() + 1;
+    buf->thread_name = tls_thread_name;
+    buffers.push_back(std::move(buf));
+    return buffers.back().get();
+}
+
+void write_sep() {
+    fputs(first_event ? "\n" : ",\n", out);
+    first_event = false;
+}
+
+// 调用方持有registry_mutex
+long drain_locked() {
+    if (!out) return 0;
+    long n = 0;
+    for (auto& b : buffers) {
+        if (!b->name_written && !b->thread_name.empty()) {
+            write_sep();
+            fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    pid, b->tid, b->thread_name.c_str());
+            b->name_written = true;
+        }
+        uint64_t head = b->head.load(memory_order_acquire);
+        uint64_t tail = b->tail.load(memory_order_relaxed);
+        for (; tail != head; tail++, n++) {
+            const TraceEvent& e = b->events[tail & (TRACE_BUFFER_EVENTS - 1)];
+            write_sep();
+            fprintf(out, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":%d,\"tid\":%d",
+                    e.name, e.ph, (long long)e.ts_us, pid, b->tid);
+            if (e.ph == 'C') {
+                fprintf(out, ",\"args\":{\"stream%d\":%lld}}", e.id < 0 ? 0 : e.id, (long long)e.value);
+            } else if (e.ph == 'B' && e.value >= 0) {
+                fprintf(out, ",\"args\":{\"frame\":%lld}}", (long long)e.value);
+            } else {
+                fputc('}', out);
+            }
+        }
+        b->tail.store(tail, memory_order_release);
+    }
+    // 不写结尾的']'也是合法的Chrome trace（JSON Array格式允许截断），运行中途即可打开
+    fflush(out);
+    written += n;
+    return n;
+}
+
+TraceBuffer* thread_buffer() {
+    TraceBuffer* b = tls_buffer;
+    if (!b) b = tls_buffer = register_thread();
+    return b;
+}
+
+// 缓冲区至少还有n个空位
+bool has_room(TraceBuffer* b, uint64_t n) {
+    uint64_t used = b->head.load(memory_order_relaxed) - b->tail.load(memory_order_acquire);
+    return used + n <= (uint64_t)TRACE_BUFFER_EVENTS;
+}
+
+// 调用方已确认有空位
+void push_event(TraceBuffer* b, char ph, const char* name, int64_t ts_us, int64_t value, int id) {
+    uint64_t head = b->head.load(memory_order_relaxed);
+    TraceEvent& e = b->events[head & (TRACE_BUFFER_EVENTS - 1)];
+    e.ts_us = ts_us;
+    e.name = name;
+    e.value = value;
+    e.id = id;
+    e.ph = ph;
+    b->head.store(head + 1, memory_order_release);
+}
+
+}  // namespace
+
+// ============ 记录 ============
+bool trace_begin(const char* name, int64_t ts_us, int64_t arg) {
+    TraceBuffer* b = thread_buffer();
+    // 开始事件本身、它的结束事件，以及外层已开始作用域的结束事件都要有位置
+    if (!has_room(b, b->reserved + 2)) {
+        b->dropped.fetch_add(2, memory_order_relaxed);
+        return false;
+    }
+    push_event(b, 'B', name, ts_us, arg, -1);
+    b->reserved++;
+    return true;
+}
+
+void trace_end(const char* name, int64_t ts_us) {
+    // 位置已在trace_begin()时预留
+    TraceBuffer* b = thread_buffer();
+    b->reserved--;
+    push_event(b, 'E', name, ts_us, -1, -1);
+}
+
+void trace_counter_event(const char* name, int64_t ts_us, int64_t value, int id) {
+    TraceBuffer* b = thread_buffer();
+    if (!has_room(b, b->reserved + 1)) {
+        b->dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    push_event(b, 'C', name, ts_us, value, id);
+}
+
+void tracer_set_thread_name(const string& name) {
+    // 线程名先存在线程局部变量里，追踪开启前创建的线程（如线程池）首次记录事件时再登记
+    tls_thread_name = name;
+    if (!tls_buffer) return;
+    lock_guard<mutex> lock(registry_mutex);
+    tls_buffer->thread_name = name;
+    tls_buffer->name_written = false;
+}
+
+// ============ 导出 ============
+bool tracer_open(const string& path) {
+    lock_guard<mutex> lock(registry_mutex);
+    if (out) return false;
+    out = fopen(path.c_str(), "w");
+    if (!out) {
+        cerr << "[错误] 无法创建追踪文件: " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    fputs("[", out);
+    out_path = path;
+    first_event = true;
+    written = 0;
+    pid = (int)getpid();
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_flush_signal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, nullptr);
+
+    g_trace_enabled.store(true, memory_order_relaxed);
+    return true;
+}
+
+long tracer_poll() {
+    if (!trace_enabled()) return 0;
+    bool flush = flush_requested != 0;
+    lock_guard<mutex> lock(registry_mutex);
+    for (size_t i = 0; i < buffers.size() && !flush; i++) {
+        const TraceBuffer& b = *buffers[i];
+        uint64_t used = b.head.load(memory_order_relaxed) - b.tail.load(memory_order_relaxed);
+        if (used > (uint64_t)TRACE_BUFFER_EVENTS / 2) flush = true;
+    }
+    if (!flush) return 0;
+    bool requested = flush_requested != 0;
+    flush_requested = 0;
+    long n = drain_locked();
+    if (requested) cout << "[追踪] 已写出 " << written << " 个事件到 " << out_path << endl;
+    return n;
+}
+
+void tracer_close() {
+    g_trace_enabled.store(false, memory_order_relaxed);
+    lock_guard<mutex> lock(registry_mutex);
+    if (!out) return;
+    drain_locked();
+    fputs("\n]\n", out);
+    fclose(out);
+    out = nullptr;
+    long dropped = 0;
+    for (auto& b : buffers) dropped += b->dropped.load(memory_order_relaxed);
+    cout << "Trace: " << written << " events written to " << out_path;
+    if (dropped) cout << " (" << dropped << " dropped, buffer full)";
+    cout << endl;
+}
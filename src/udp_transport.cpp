@@ -0,0 +1,242 @@
+#include "udp_transport.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+bool parse_udp_endpoint(const string& spec, sockaddr_in& addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(UDP_DEFAULT_PORT);
+    size_t colon = spec.rfind(':');
+    string host = colon == string::npos ? spec : spec.substr(0, colon);
+    if (colon != string::npos) {
+        int port = atoi(spec.c_str() + colon + 1);
+        if (port <= 0 || port > 65535) return false;
+        addr.sin_port = htons(port);
+    }
+    if (host.empty() || host == "localhost") host = "127.0.0.1";
+    return inet_pton(AF_INET, host.c_str(), &addr.sin_addr) == 1;
+}
+
+// ============ UdpSender 成员函数实现 ============
+UdpSender::~UdpSender() { close(); }
+
+bool UdpSender::open(const string& endpoint) {
+    close();
+    if (!parse_udp_endpoint(endpoint, addr_)) {
+        cerr << "[错误] UDP地址无效: " << endpoint << endl;
+        return false;
+    }
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        cerr << "[错误] 创建UDP socket失败: " << strerror(errno) << endl;
+        return false;
+    }
+    // connect后内核不再逐包查路由，sendmmsg也无需逐条填地址
+    if (connect(fd_, reinterpret_cast<sockaddr*>(&addr_), sizeof(addr_)) != 0) {
+        cerr << "[错误] UDP connect失败: " << strerror(errno) << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void UdpSender::close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+}
+
+void UdpSender::send(const vector<OutPacket>& packets) {
+    if (fd_ < 0) return;
+    mmsghdr msgs[UDP_BATCH];
+    iovec iov[UDP_BATCH];
+    size_t i = 0;
+    while (i < packets.size()) {
+        int n = (int)min<size_t>(UDP_BATCH, packets.size() - i);
+        memset(msgs, 0, sizeof(mmsghdr) * n);
+        for (int k = 0; k < n; k++) {
+            iov[k].iov_base = const_cast<uint8_t*>(packets[i + k].data);
+            iov[k].iov_len = packets[i + k].len;
+            msgs[k].msg_hdr.msg_iov = &iov[k];
+            msgs[k].msg_hdr.msg_iovlen = 1;
+        }
+        int sent = sendmmsg(fd_, msgs, n, MSG_DONTWAIT);
+        stats_.syscalls++;
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            // EAGAIN或对端不可达（ECONNREFUSED）：丢弃本轮剩余包，不阻塞流水线
+            stats_.dropped += (long)(packets.size() - i);
+            return;
+        }
+        for (int k = 0; k < sent; k++) {
+            stats_.sent++;
+            stats_.bytes += msgs[k].msg_len;
+        }
+        i += sent;
+        if (sent < n) {
+            stats_.dropped += (long)(packets.size() - i);
+            return;
+        }
+    }
+}
+
+// ============ UdpReceiver 成员函数实现 ============
+UdpReceiver::~UdpReceiver() { close(); }
+
+bool UdpReceiver::open(int port) {
+    close();
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) return false;
+    int one = 1;
+    setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        cerr << "[错误] UDP bind端口" << port << "失败: " << strerror(errno) << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void UdpReceiver::close() {
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+}
+
+int UdpReceiver::receive(vector<OutPacket>& out, int timeout_ms) {
+    if (fd_ < 0) return -1;
+    pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int rc = poll(&pfd, 1, timeout_ms);
+    if (rc < 0) return errno == EINTR ? 0 : -1;
+    if (rc == 0) return 0;
+
+    mmsghdr msgs[UDP_BATCH];
+    iovec iov[UDP_BATCH];
+    memset(msgs, 0, sizeof(msgs));
+    for (int k = 0; k < UDP_BATCH; k++) {
+        iov[k].iov_base = bufs_[k];
+        iov[k].iov_len = sizeof(bufs_[k]);
+        msgs[k].msg_hdr.msg_iov = &iov[k];
+        msgs[k].msg_hdr.msg_iovlen = 1;
+    }
+    int n = recvmmsg(fd_, msgs, UDP_BATCH, MSG_DONTWAIT, nullptr);
+    if (n < 0) return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+
+    int count = 0;
+    OutPacket pkt;
+    for (int k = 0; k < n; k++) {
+        if ((msgs[k].msg_hdr.msg_flags & MSG_TRUNC) ||
+            !classify_packet(bufs_[k], (int)msgs[k].msg_len, pkt)) {
+            invalid_++;
+            continue;
+        }
+        out.push_back(pkt);
+        count++;
+    }
+    return count;
+}
+
+// ============ LinkMonitor 成员函数实现 ============
+void LinkMonitor::SeqTracker::update(uint32_t seq, uint32_t modulo, LinkStats& st) {
+    if (!started) {
+        started = true;
+        last = seq;
+        missing.reset();
+        return;
+    }
+    uint32_t ahead = (seq - last) % modulo;  // 相对已收最大序号前进了多少（模序号空间）
+    if (ahead == 0) {
+        st.duplicated++;
+    } else if (ahead <= modulo / 2) {
+        // 跳过的序号last+1..seq-1计为丢包，并在窗口中记下，迟到时据此回补
+        st.lost += ahead - 1;
+        missing <<= ahead;
+        for (uint32_t i = 0; i + 1 < ahead && i < (uint32_t)WINDOW; i++) missing.set(i);
+        last = seq;
+    } else {
+        // 比最大序号旧：只有之前按丢包计入的序号才是迟到的包并回补，否则是重复包
+        uint32_t behind = (last - seq) % modulo;
+        if (behind > (uint32_t)WINDOW) {
+            st.reordered++;  // 超出窗口，无法判断是否计过丢包，不回补
+        } else if (missing.test(behind - 1)) {
+            missing.reset(behind - 1);
+            st.reordered++;
+            st.lost--;
+        } else {
+            st.duplicated++;
+        }
+    }
+}
+
+void LinkMonitor::on_packet(const OutPacket& pkt, int64_t recv_us) {
+    int sid = min(max(pkt.stream_id, 0), MAX_STREAMS - 1);
+    LinkStats& st = stats_[sid];
+    st.received++;
+    st.bytes += pkt.len;
+
+    uint32_t ts;
+    if (pkt.type == OutPacket::MAP) {
+        const MqttPacket* p = reinterpret_cast<const MqttPacket*>(pkt.data);
+        map_seq_[sid].update(p->frame_seq, 256, st);
+        ts = packet_capture_ts(*p);
+    } else if (pkt.type == OutPacket::PARITY) {
+        return;  // 校验包不单独编号，也不带时间戳
+    } else {
+        BallPacket bp;
+        memcpy(&bp, pkt.data, sizeof(bp));
+        ball_seq_[sid].update(bp.seq, 65536, st);
+        ts = bp.capture_us;
+    }
+    // 32位微秒时间戳约71分钟回绕一次，无符号差值在回绕时依然正确
+    if (ts != 0) st.latency_us.push_back((int32_t)((uint32_t)recv_us - ts));
+}
+
+void LinkMonitor::reset_stats() {
+    for (int i = 0; i < MAX_STREAMS; i++) stats_[i] = LinkStats();
+}
+
+// ============ 统计输出 ============
+void print_udp_send_stats(const UdpSendStats& stats, double elapsed_sec) {
+    if (elapsed_sec <= 0) return;
+    cout << "UDP: sent " << stats.sent << " (" << fixed << setprecision(1)
+         << stats.sent / elapsed_sec << " pkt/s, " << setprecision(0) << stats.bytes / elapsed_sec
+         << " B/s), dropped " << stats.dropped << ", " << setprecision(2)
+         << (stats.syscalls ? (double)stats.sent / stats.syscalls : 0.0) << " pkt/syscall" << endl;
+}
+
+void print_link_stats(const LinkStats& stats, double elapsed_sec, const string& label) {
+    if (stats.received == 0 || elapsed_sec <= 0) return;
+    long expected = stats.received - stats.duplicated + stats.lost;
+    cout << "[" << label << "] received " << stats.received << " (" << fixed << setprecision(1)
+         << stats.received / elapsed_sec << " pkt/s, " << setprecision(0) << stats.bytes / elapsed_sec
+         << " B/s), lost " << stats.lost << " (" << setprecision(2)
+         << (expected > 0 ? 100.0 * stats.lost / expected : 0.0) << "%), reordered " << stats.reordered
+         << ", duplicated " << stats.duplicated;
+    if (!stats.latency_us.empty()) {
+        vector<int64_t> lat = stats.latency_us;
+        sort(lat.begin(), lat.end());
+        int64_t sum = 0;
+        for (int64_t v : lat) sum += v;
+        cout << ", one-way latency avg " << sum / 1000.0 / lat.size()
+             << " / p50 " << lat[lat.size() / 2] / 1000.0
+             << " / p99 " << lat[(lat.size() - 1) * 99 / 100] / 1000.0
+             << " / max " << lat.back() / 1000.0 << " ms";
+    }
+    cout << endl;
+}
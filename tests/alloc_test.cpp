@@ -0,0 +1,178 @@
+#include "header.h"
+#include "hero_api.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace cv;
+using namespace std;
+
+// ============ 稳态堆分配回归测试 ============
+// 在固定画面上预热后，重复调用encode()、process()与C接口hero_compress_frame()，统计每帧堆分配次数与字节数。
+// 阈值不是写死的数字，而是在同一画面上实测的参照值：参照按encodeFrame()的顺序执行同样的
+// OpenCV调用，中间缓冲区同样跨帧复用，测得的就是OpenCV内部（Canny、findContours、
+// 原地形态学等）不可避免的分配。encode()与C接口只允许比参照多ENCODE_MARGIN_ALLOCS次，
+// 压缩器自身每帧多分配一个缓冲区（每个Mat计2次：数据区与UMatData）就会失败。
+// 关闭OpenCV内部并行，所有分配都在本线程上且每次运行一致。
+
+constexpr int WARMUP_FRAMES = 5;
+constexpr int MEASURE_FRAMES = 50;
+
+constexpr double ENCODE_MARGIN_ALLOCS = 1;
+constexpr double ENCODE_MARGIN_BYTES = 4096;
+// process()另外返回originalMarked（整帧BGR）与finalBinary（TARGET_SIZE），每个Mat计2次；
+// 每个弹丸还要记录位置并画两个标记圆（折线顶点vector逐点增长），按每个弹丸24次放宽。
+// 这些按帧分配是接口约定的一部分；压缩器自身的回归由encode()的检查覆盖
+constexpr double PROCESS_FIXED_ALLOCS = 4;
+constexpr double PROCESS_ALLOCS_PER_BALL = 24;
+constexpr double PROCESS_MARGIN_BYTES = 65536;
+
+// 没有测试视频时的合成画面：暗色噪声背景上的场地线条与绿色弹丸
+static Mat synthetic_scene() {
+    Mat img(720, 1280, CV_8UC3);
+    randu(img, Scalar(20, 20, 20), Scalar(60, 60, 60));  // 新进程中theRNG()种子固定，画面可复现
+    for (int k = 0; k < 12; k++) {
+        line(img, Point(k * 107, 0), Point(1279 - k * 53, 719), Scalar(220, 220, 220), 3);
+    }
+    rectangle(img, Rect(200, 150, 880, 420), Scalar(230, 230, 230), 4);
+    for (int k = 0; k < 6; k++) {
+        circle(img, Point(300 + k * 130, 360 + (k % 2) * 90), 18, Scalar(60, 220, 60), -1);
+    }
+    return img;
+}
+
+// ============ 参照流水线 ============
+// 与HeroCamCompressor::encodeFrame()（无线程池、不要结果细节）相同的OpenCV调用序列；
+// 压缩器的处理步骤改变时这里要同步修改
+struct ReferencePipeline {
+    Mat kernel1 = getStructuringElement(MORPH_RECT, Size(2, 2));
+    Mat kernel2 = getStructuringElement(MORPH_RECT, Size(4, 4));
+    Mat gray, blurred, edges, eroded, visualization, hsv, greenMask, resized, binary;
+    vector<vector<Point>> contours, ballContours;
+
+    void run(const Mat& input) {
+        cvtColor(input, gray, COLOR_BGR2GRAY);
+        GaussianBlur(gray, blurred, Size(5, 5), 1.3);
+        Canny(blurred, edges, 50, 150);
+        findContours(edges, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+        visualization.create(input.size(), CV_8UC1);
+        visualization.setTo(Scalar(0));
+        drawContours(visualization, contours, -1, Scalar(255), 2);
+        erode(visualization, eroded, kernel1);
+        dilate(eroded, visualization, kernel2);
+
+        cvtColor(input, hsv, COLOR_BGR2HSV);
+        inRange(hsv, BALL_HSV_LOW, BALL_HSV_HIGH, greenMask);
+        morphologyEx(greenMask, greenMask, MORPH_CLOSE, kernel1);
+        dilate(greenMask, greenMask, kernel2);
+        findContours(greenMask, ballContours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+        sort(ballContours.begin(), ballContours.end(),
+             [](const vector<Point>& a, const vector<Point>& b) {
+                 return contourArea(a) > contourArea(b);
+             });
+
+        int validBalls = 0;
+        for (const auto& cnt : ballContours) {
+            double area = contourArea(cnt);
+            if (area < MIN_BALL_AREA || area > MAX_BALL_AREA) continue;
+            double perim = arcLength(cnt, true);
+            if (perim <= 0) continue;
+            double circularity = 4.0 * CV_PI * area / (perim * perim);
+            if (circularity < MIN_BALL_CIRCULARITY) continue;
+            Rect rect = boundingRect(cnt);
+            double aspect = static_cast<double>(rect.width) / rect.height;
+            if (aspect < 1.0) aspect = 1.0 / aspect;
+            if (aspect > MAX_BALL_ASPECT_RATIO) continue;
+            Point2f center;
+            float radius;
+            minEnclosingCircle(cnt, center, radius);
+            if (validBalls < 4) validBalls++;
+            else break;
+        }
+
+        bitwise_or(visualization, greenMask, visualization);
+        resize(visualization, resized, TARGET_SIZE, 0, 0, INTER_LINEAR);
+        threshold(resized, binary, 128, 255, THRESH_BINARY);
+    }
+};
+
+// 预热后连续调用MEASURE_FRAMES次，返回每帧平均分配
+template <class F>
+static void measure(F f, double& allocs, double& bytes) {
+    for (int i = 0; i < WARMUP_FRAMES; i++) f();
+    AllocCounters a0 = alloc_thread_counters();
+    for (int i = 0; i < MEASURE_FRAMES; i++) f();
+    AllocCounters a1 = alloc_thread_counters();
+    allocs = (double)(a1.count - a0.count) / MEASURE_FRAMES;
+    bytes = (double)(a1.bytes - a0.bytes) / MEASURE_FRAMES;
+}
+
+static bool check(const char* name, double allocs, double bytes, double max_allocs, double max_bytes) {
+    bool ok = allocs <= max_allocs && bytes <= max_bytes;
+    cout << name << ": " << allocs << " allocs/frame (max " << max_allocs << "), "
+         << (long)bytes << " bytes/frame (max " << (long)max_bytes << ")"
+         << (ok ? "" : "  FAILED") << endl;
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    if (!ALLOC_STATS_ENABLED) {
+        cerr << "[错误] alloc_test 需要以 HERO_ALLOC_STATS 构建" << endl;
+        return 1;
+    }
+    setNumThreads(0);
+
+    Mat scene;
+    if (argc > 1) {
+        VideoCapture cap(argv[1]);
+        if (cap.isOpened()) cap.read(scene);
+    }
+    if (scene.empty()) {
+        scene = synthetic_scene();
+        cout << "Input: synthetic scene" << endl;
+    } else {
+        cout << "Input: " << argv[1] << " (" << scene.cols << "x" << scene.rows << ")" << endl;
+    }
+
+    ReferencePipeline ref;
+    double ref_allocs, ref_bytes;
+    measure([&]() { ref.run(scene); }, ref_allocs, ref_bytes);
+    cout << "reference (OpenCV calls only): " << ref_allocs << " allocs/frame, "
+         << (long)ref_bytes << " bytes/frame" << endl;
+
+    HeroCamCompressor encoder;
+    MqttPacket pkt;
+    double encode_allocs, encode_bytes;
+    measure([&]() { encoder.encode(scene, pkt); }, encode_allocs, encode_bytes);
+
+    // process()：结果在lambda内析构，计入的是每帧新分配
+    HeroCamCompressor processor;
+    size_t balls = 0;  // 画了标记的弹丸数（不受数据包4个的上限）
+    double process_allocs, process_bytes;
+    measure([&]() { balls = processor.process(scene).ballCenters.size(); }, process_allocs, process_bytes);
+    double result_bytes = (double)scene.total() * 3 + TARGET_SIZE.area();
+
+    // C接口：BGR24直接包装调用者内存，句柄本身每次调用不应有任何分配
+    hero_compressor* handle = hero_compressor_create(0);
+    uint8_t out[HERO_PACKET_BYTES];
+    int api_ret = HERO_OK;
+    double api_allocs, api_bytes;
+    measure([&]() {
+        int r = hero_compress_frame(handle, scene.data, scene.cols, scene.rows, (int)scene.step,
+                                    HERO_FORMAT_BGR24, out, nullptr);
+        if (r != HERO_OK) api_ret = r;
+    }, api_allocs, api_bytes);
+    hero_compressor_destroy(handle);
+
+    bool ok = check("encode()", encode_allocs, encode_bytes,
+                    ref_allocs + ENCODE_MARGIN_ALLOCS, ref_bytes + ENCODE_MARGIN_BYTES);
+    ok = check("process()", process_allocs, process_bytes,
+               ref_allocs + PROCESS_FIXED_ALLOCS + PROCESS_ALLOCS_PER_BALL * balls,
+               ref_bytes + result_bytes + PROCESS_MARGIN_BYTES) && ok;
+    ok = check("hero_compress_frame()", api_allocs, api_bytes,
+               ref_allocs + ENCODE_MARGIN_ALLOCS, ref_bytes + ENCODE_MARGIN_BYTES) && ok;
+    if (api_ret != HERO_OK) {
+        cerr << "[失败] hero_compress_frame: " << hero_strerror(api_ret) << endl;
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+#include "udp_transport.h"
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+// ============ 链路统计序号测试 ============
+// 迟到的包只回补之前按丢包计入的序号；重复收到的旧包（含已回补过的）计为重复，不得抵消真实丢包。
+
+struct Case {
+    const char* name;
+    bool map;                    // true：8位地图包序号；false：16位弹丸包序号
+    vector<int> seqs;
+    long lost, reordered, duplicated;
+};
+
+static OutPacket make_packet(bool map, int seq) {
+    OutPacket p;
+    memset(&p, 0, sizeof(p));
+    p.stream_id = 0;
+    if (map) {
+        p.type = OutPacket::MAP;
+        p.len = TOTAL_PACKET_BYTE;
+        reinterpret_cast<MqttPacket*>(p.data)->frame_seq = (uint8_t)seq;
+    } else {
+        BallPacket bp;
+        memset(&bp, 0, sizeof(bp));
+        bp.magic = BALL_PACKET_MAGIC;
+        bp.seq = (uint16_t)seq;
+        p.type = OutPacket::BALL;
+        p.len = BALL_PACKET_BYTE;
+        memcpy(p.data, &bp, sizeof(bp));
+    }
+    return p;
+}
+
+int main() {
+    vector<Case> cases = {
+        {"reorder", false, {1, 2, 4, 3}, 0, 1, 0},
+        {"old duplicates", false, {1, 2, 3, 2, 1}, 0, 0, 2},
+        {"loss then old duplicate", false, {1, 3, 1}, 1, 0, 1},
+        {"late packet repeated", false, {1, 3, 2, 2}, 0, 1, 1},
+        {"map seq wraparound", true, {254, 255, 1, 0}, 0, 1, 0},
+        {"large gap", false, {1, 400, 399}, 397, 1, 0},
+        {"late packet beyond window", false, {1, 400, 200}, 398, 1, 0},
+    };
+
+    bool ok = true;
+    for (const Case& c : cases) {
+        LinkMonitor mon;
+        for (int s : c.seqs) mon.on_packet(make_packet(c.map, s), 0);
+        const LinkStats& st = mon.stats(0);
+        bool pass = st.lost == c.lost && st.reordered == c.reordered && st.duplicated == c.duplicated;
+        cout << c.name << ": lost " << st.lost << ", reordered " << st.reordered
+             << ", duplicated " << st.duplicated << (pass ? "" : "  FAILED") << endl;
+        ok = ok && pass;
+    }
+    return ok ? 0 : 1;
+}
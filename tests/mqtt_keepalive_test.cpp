@@ -0,0 +1,169 @@
+#include "mqtt_publisher.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// ============ MQTT心跳回环测试 ============
+// 本地起一个最小broker（只回CONNACK与PINGRESP），以keepalive=1s持续发布超过2个keepalive周期，
+// 发布者不得因心跳超时断线重连。QoS0发布没有应答，心跳只能靠PINGREQ/PINGRESP维持。
+
+constexpr int KEEPALIVE_S = 1;
+constexpr int RUN_MS = 2 * KEEPALIVE_S * 1000 + 1500;
+constexpr int PUBLISH_INTERVAL_MS = 5;
+
+struct FakeBroker {
+    int listen_fd = -1;
+    int port = 0;
+    atomic<bool> stop{false};
+    atomic<int> connections{0};
+    atomic<int> pings{0};
+    atomic<long> publishes{0};
+    thread th;
+
+    bool start() {
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd < 0) return false;
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 4) != 0 ||
+            getsockname(listen_fd, (sockaddr*)&addr, &len) != 0) {
+            return false;
+        }
+        port = ntohs(addr.sin_port);
+        th = thread(&FakeBroker::run, this);
+        return true;
+    }
+
+    void join() {
+        stop = true;
+        if (th.joinable()) th.join();
+        if (listen_fd >= 0) close(listen_fd);
+    }
+
+    // 解析缓冲区头部的完整报文并应答；返回false表示连接应关闭
+    bool handle(int fd, vector<uint8_t>& in) {
+        while (in.size() >= 2) {
+            size_t body = 0, pos = 1;
+            int shift = 0;
+            while (true) {
+                if (pos >= in.size()) return true;
+                body |= (size_t)(in[pos] & 0x7F) << shift;
+                shift += 7;
+                if (!(in[pos++] & 0x80)) break;
+            }
+            if (in.size() < pos + body) return true;
+            uint8_t type = in[0] & 0xF0;
+            if (type == 0x10) {
+                uint8_t connack[4] = {0x20, 0x02, 0x00, 0x00};
+                if (send(fd, connack, sizeof(connack), MSG_NOSIGNAL) != sizeof(connack)) return false;
+            } else if (type == 0xC0) {
+                uint8_t pingresp[2] = {0xD0, 0x00};
+                if (send(fd, pingresp, sizeof(pingresp), MSG_NOSIGNAL) != sizeof(pingresp)) return false;
+                pings++;
+            } else if (type == 0x30) {
+                publishes++;
+            } else if (type == 0xE0) {
+                return false;
+            }
+            in.erase(in.begin(), in.begin() + pos + body);
+        }
+        return true;
+    }
+
+    void run() {
+        int client = -1;
+        vector<uint8_t> in;
+        while (!stop) {
+            pollfd fds[2];
+            fds[0].fd = listen_fd;
+            fds[0].events = POLLIN;
+            fds[1].fd = client;
+            fds[1].events = POLLIN;
+            fds[0].revents = fds[1].revents = 0;
+            if (poll(fds, client >= 0 ? 2 : 1, 50) <= 0) continue;
+            if (fds[0].revents & POLLIN) {
+                // 新连接替换旧连接（发布者重连时旧连接已被它关闭）
+                int fd = accept(listen_fd, nullptr, nullptr);
+                if (fd >= 0) {
+                    if (client >= 0) close(client);
+                    client = fd;
+                    in.clear();
+                    connections++;
+                }
+                continue;
+            }
+            if (client >= 0 && (fds[1].revents & (POLLIN | POLLERR | POLLHUP))) {
+                uint8_t buf[4096];
+                ssize_t n = recv(client, buf, sizeof(buf), 0);
+                if (n > 0) in.insert(in.end(), buf, buf + n);
+                if (n <= 0 || !handle(client, in)) {
+                    close(client);
+                    client = -1;
+                }
+            }
+        }
+        if (client >= 0) close(client);
+    }
+};
+
+int main() {
+    FakeBroker broker;
+    if (!broker.start()) {
+        cerr << "[错误] 无法启动本地broker" << endl;
+        return 1;
+    }
+
+    MqttConfig cfg;
+    cfg.host = "127.0.0.1";
+    cfg.port = broker.port;
+    cfg.keepalive_s = KEEPALIVE_S;
+    cfg.client_id = "keepalive_test";
+
+    OutPacket pkt;
+    memset(&pkt, 0, sizeof(pkt));
+    pkt.type = OutPacket::BALL;
+    pkt.len = BALL_PACKET_BYTE;
+
+    MqttStats st;
+    {
+        MqttPublisher publisher(cfg);
+        for (int t = 0; t < RUN_MS; t += PUBLISH_INTERVAL_MS) {
+            publisher.publish(pkt);
+            this_thread::sleep_for(chrono::milliseconds(PUBLISH_INTERVAL_MS));
+        }
+        st = publisher.stats();
+    }
+    broker.join();
+
+    cout << "connections " << broker.connections << ", pings " << broker.pings
+         << ", publishes " << broker.publishes << ", reconnects " << st.reconnects
+         << ", connected " << st.connected << endl;
+
+    bool ok = true;
+    if (broker.connections != 1 || st.reconnects != 0 || !st.connected) {
+        cerr << "[失败] 持续发布期间发生断线重连" << endl;
+        ok = false;
+    }
+    if (broker.pings < 2) {
+        cerr << "[失败] 持续发布期间没有按keepalive发送PINGREQ" << endl;
+        ok = false;
+    }
+    if (broker.publishes == 0) {
+        cerr << "[失败] broker未收到任何PUBLISH" << endl;
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
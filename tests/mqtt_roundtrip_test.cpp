@@ -0,0 +1,156 @@
+#include "mqtt_publisher.h"
+#include <arpa/inet.h>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+// ============ MQTT回环测试（真实broker） ============
+// 在随机端口上启动本机的mosquitto，MqttPublisher按 <topic>/<流编号>/{map,ball,fec} 发布，
+// MqttSubscriber订阅同一前缀，每路流的三种包都必须原样收到。PATH中没有mosquitto时跳过。
+
+constexpr int SKIP_CODE = 77;             // 与CMake中的SKIP_RETURN_CODE一致
+constexpr int STREAMS = 2;
+constexpr int TIMEOUT_MS = 8000;
+constexpr int PUBLISH_INTERVAL_MS = 20;
+
+static bool on_path(const char* prog) {
+    const char* path = getenv("PATH");
+    if (!path) return false;
+    string dirs = path;
+    size_t start = 0;
+    while (start <= dirs.size()) {
+        size_t end = dirs.find(':', start);
+        if (end == string::npos) end = dirs.size();
+        string file = dirs.substr(start, end - start) + "/" + prog;
+        if (access(file.c_str(), X_OK) == 0) return true;
+        start = end + 1;
+    }
+    return false;
+}
+
+// 向内核要一个空闲端口；关闭后立刻交给mosquitto使用
+static int free_port() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    int port = -1;
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0 && getsockname(fd, (sockaddr*)&addr, &len) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    close(fd);
+    return port;
+}
+
+static OutPacket make_packet(OutPacket::Type type, int sid) {
+    OutPacket p;
+    memset(&p, 0, sizeof(p));
+    p.type = type;
+    p.stream_id = sid;
+    p.len = type == OutPacket::MAP ? TOTAL_PACKET_BYTE : type == OutPacket::BALL ? BALL_PACKET_BYTE
+                                                                                 : PARITY_PACKET_BYTE;
+    if (type == OutPacket::BALL) p.data[0] = BALL_PACKET_MAGIC;
+    if (type == OutPacket::PARITY) p.data[0] = PARITY_PACKET_MAGIC;
+    p.data[1] = (uint8_t)((sid << CFG_STREAM_SHIFT) & CFG_STREAM_MASK);
+    // 负载其余字节填入可辨认的内容，接收端逐字节比对
+    for (int i = 2; i < p.len; i++) p.data[i] = (uint8_t)(i * 7 + sid * 31 + type);
+    return p;
+}
+
+int main() {
+    if (!on_path("mosquitto")) {
+        cout << "mosquitto not found on PATH, skipping" << endl;
+        return SKIP_CODE;
+    }
+    int port = free_port();
+    if (port <= 0) {
+        cerr << "[错误] 无法分配本地端口" << endl;
+        return 1;
+    }
+
+    pid_t broker = fork();
+    if (broker == 0) {
+        string p = to_string(port);
+        execlp("mosquitto", "mosquitto", "-p", p.c_str(), (char*)nullptr);
+        _exit(127);
+    }
+    if (broker < 0) {
+        cerr << "[错误] 无法启动mosquitto" << endl;
+        return 1;
+    }
+
+    MqttConfig cfg;
+    cfg.host = "127.0.0.1";
+    cfg.port = port;
+    cfg.topic = "hero_test";
+    cfg.keepalive_s = 2;
+
+    vector<OutPacket> sent;
+    for (int sid = 0; sid < STREAMS; sid++) {
+        sent.push_back(make_packet(OutPacket::MAP, sid));
+        sent.push_back(make_packet(OutPacket::BALL, sid));
+        sent.push_back(make_packet(OutPacket::PARITY, sid));
+    }
+    vector<bool> got(sent.size(), false);
+    bool mismatch = false;
+
+    {
+        MqttConfig sub_cfg = cfg;
+        sub_cfg.client_id = "hero_roundtrip_sub";
+        MqttSubscriber subscriber(sub_cfg);
+        MqttConfig pub_cfg = cfg;
+        pub_cfg.client_id = "hero_roundtrip_pub";
+        MqttPublisher publisher(pub_cfg);
+
+        // QoS0不补发：订阅生效前发布的包会丢失，所以持续重发直到每种包都收到
+        vector<OutPacket> in;
+        int64_t deadline = monotonic_us() + TIMEOUT_MS * 1000L;
+        size_t received = 0;
+        while (received < sent.size() && monotonic_us() < deadline) {
+            for (const OutPacket& p : sent) publisher.publish(p);
+            in.clear();
+            subscriber.receive(in, PUBLISH_INTERVAL_MS);
+            for (const OutPacket& r : in) {
+                for (size_t k = 0; k < sent.size(); k++) {
+                    const OutPacket& s = sent[k];
+                    if (r.type != s.type || r.stream_id != s.stream_id) continue;
+                    if (r.len != s.len || memcmp(r.data, s.data, s.len) != 0) {
+                        mismatch = true;
+                    } else if (!got[k]) {
+                        got[k] = true;
+                        received++;
+                    }
+                }
+            }
+        }
+    }
+
+    kill(broker, SIGTERM);
+    waitpid(broker, nullptr, 0);
+
+    bool ok = !mismatch;
+    if (mismatch) cerr << "[失败] 收到的包与发出的内容不一致" << endl;
+    const char* names[] = {"map", "ball", "fec"};
+    for (size_t k = 0; k < sent.size(); k++) {
+        if (!got[k]) {
+            cerr << "[失败] 未收到 " << cfg.topic << "/" << sent[k].stream_id << "/"
+                 << names[sent[k].type] << endl;
+            ok = false;
+        }
+    }
+    if (ok) cout << "received all " << sent.size() << " packet kinds via mosquitto on port " << port << endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+#include "sender.h"
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// ============ 带宽预算下的校验包测试 ============
+// 开启--budget与FEC时，凑满一组的地图包必须连同校验包一起发出：令牌不足时推迟整个地图包，
+// 而不是发出地图包后再放弃校验包。分别测单路自有令牌桶与多路共享令牌桶（容量按流数放大）。
+
+constexpr int FEC_GROUP = 3;
+constexpr double FPS = 30.0;
+constexpr int RUN_S = 20;
+
+// 以FPS帧率驱动各路发送器RUN_S秒，返回是否满足：有校验包、没有因令牌不足放弃的校验包、每组一个
+static bool run_case(const char* name, int streams, long budget, bool shared) {
+    SenderConfig cfg;
+    cfg.budget_bytes_per_sec = budget;
+    cfg.fec_group = FEC_GROUP;
+
+    TokenBucket link(budget, cfg.burst_bytes * streams);
+    vector<unique_ptr<DualRateSender>> senders;
+    for (int i = 0; i < streams; i++) {
+        senders.emplace_back(new DualRateSender(cfg));
+        if (shared) senders.back()->setTokenBucket(&link);
+    }
+
+    ProcessResult result;
+    result.packet.balls[0] = BallInfo{40, 30, 2};
+    vector<OutPacket> out;
+    int64_t t0 = 1000000;
+    int frames = (int)(RUN_S * FPS);
+    for (int f = 0; f < frames; f++) {
+        int64_t now = t0 + (int64_t)(f * 1e6 / FPS);
+        for (int i = 0; i < streams; i++) {
+            result.meta.stream_id = (uint8_t)i;
+            result.meta.capture_us = now;
+            senders[i]->on_frame(result, now, out);
+        }
+    }
+
+    bool ok = true;
+    for (int i = 0; i < streams; i++) {
+        const SenderStats& st = senders[i]->stats();
+        cout << name << " stream " << i << ": maps " << st.map_packets << ", parity " << st.parity_packets
+             << ", parity skipped " << st.parity_skipped << ", balls " << st.ball_packets
+             << ", deferred maps " << st.deferred_maps << endl;
+        if (st.parity_packets == 0 || st.parity_skipped != 0 ||
+            st.parity_packets != st.map_packets / FEC_GROUP) {
+            cerr << "[失败] " << name << " stream " << i << ": 带宽预算下校验包未随地图包发出" << endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main() {
+    bool ok = run_case("own bucket", 1, 3000, false);
+    ok = run_case("shared bucket", 2, 6000, true) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+#include "tracer.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// ============ 追踪缓冲区写满测试 ============
+// 不调用tracer_poll()，让本线程缓冲区写满；被丢弃的必须是整段作用域，
+// 导出的开始/结束事件按顺序成对，嵌套深度不会小于0，结束时回到0。
+
+constexpr int ITERATIONS = TRACE_BUFFER_EVENTS;  // 每次5个事件，远超缓冲区容量
+
+int main() {
+    string path = "tracer_test.json";
+    if (!tracer_open(path)) {
+        cerr << "[错误] 无法打开追踪文件" << endl;
+        return 1;
+    }
+    for (int i = 0; i < ITERATIONS; i++) {
+        TraceScope outer("outer", i);
+        TraceScope inner("inner");
+        trace_counter("counter", 0, i);
+    }
+    tracer_close();
+
+    ifstream in(path);
+    string line;
+    long begins = 0, ends = 0, depth = 0;
+    bool ok = true;
+    while (getline(in, line)) {
+        if (line.find("\"ph\":\"B\"") != string::npos) {
+            begins++;
+            depth++;
+        } else if (line.find("\"ph\":\"E\"") != string::npos) {
+            ends++;
+            if (--depth < 0) ok = false;
+        }
+    }
+    remove(path.c_str());
+
+    cout << "begin " << begins << ", end " << ends << ", final depth " << depth << endl;
+    if (!ok || depth != 0 || begins == 0) {
+        cerr << "[失败] 缓冲区写满后导出的开始/结束事件不成对" << endl;
+        return 1;
+    }
+    return 0;
+}